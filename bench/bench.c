@@ -0,0 +1,355 @@
+
+/** bench/bench.c, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * Runs the generator over a matrix of options with fixed seeds, and
+ * prints one CSV line (or JSON object) per run: steps and cells carved
+ * per second, peak memory, and how the time splits between moving heads,
+ * switching branches and writing the image. Each run happens in its own
+ * process, so the peak memory of one run doesn't hide another's. In
+ * 'kruskal' mode, which has no heads, the heads are the number of threads
+ * `kruskal_run()` is given, so `-modes kruskal -heads 1,2,4,8` measures
+ * how it scales.
+ *
+ * On Linux, each run also counts the last level cache, L1 data cache and
+ * data TLB misses of generating the maze, where the kernel lets it; they
+ * are -1 where it doesn't, as in most virtual machines. Comparing the
+ * layouts on wide mazes shows what MAZE_LAYOUT_BLOCKS saves:
+ *
+ *  ./bench-maze -modes depth,random -sizes 100000 -heights 200 -steps 2 -heads 1 -layouts rows,blocks
+ *
+ *  cc -O2 -pthread -DMAZE_STATS -Isrc -o bench-maze bench/bench.c src/maze.c src/kruskal.c src/arena.c src/map.c src/blist.c src/rng.c src/image.c
+ *  ./bench-maze -sizes 500,2000 -steps 2,3 -heads 1,4 -json > results.json
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#ifdef __linux__
+#define _DEFAULT_SOURCE
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include "maze.h"
+#include "image.h"
+#include "kruskal.h"
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#ifndef MAZE_STATS
+#error "Build the benchmark with -DMAZE_STATS, see the top of this file."
+#endif
+
+#define MAX_VALUES 16
+
+typedef struct list_s {
+    int values[MAX_VALUES];
+    int length;
+} list_t;
+
+static const char* mode_names[] = {NULL, "random", "depth", "breadth", NULL, "kruskal"};
+static const char* layout_names[] = {"rows", "blocks"};
+
+static bool json = false;
+static bool first = true;
+static const char* outfile = "bench.bmp";
+
+static double seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void parse_list(list_t* list, const char* text)
+{
+    list->length = 0;
+    while(*text && list->length < MAX_VALUES)
+    {
+        char* end;
+        long value = strtol(text, &end, 10);
+        if(end == text) break;
+
+        list->values[list->length++] = value;
+        text = (*end == ',') ? end + 1 : end;
+    }
+}
+
+static void parse_modes(list_t* list, const char* text)
+{
+    list->length = 0;
+    for(int mode = MODE_RANDOM_SWITCHING; mode <= MODE_KRUSKAL; mode++)
+    {
+        if(mode_names[mode] != NULL && strstr(text, mode_names[mode]) != NULL)
+            list->values[list->length++] = mode;
+    }
+}
+
+static void parse_layouts(list_t* list, const char* text)
+{
+    list->length = 0;
+    for(int layout = MAZE_LAYOUT_ROWS; layout <= MAZE_LAYOUT_BLOCKS; layout++)
+    {
+        if(strstr(text, layout_names[layout]) != NULL)
+            list->values[list->length++] = layout;
+    }
+}
+
+// C O U N T E R S //
+// =============== //
+
+enum {
+    COUNTER_CACHE,
+    COUNTER_L1D,
+    COUNTER_DTLB,
+    COUNTERS
+};
+
+/** \brief Starts counting hardware events of this process, leaving -1 in
+ *  `fds` for each one which can't be counted.
+ */
+static void counters_start(int fds[COUNTERS])
+{
+#ifdef __linux__
+    static const unsigned long long configs[COUNTERS][2] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+    };
+
+    for(int i = 0; i < COUNTERS; i++)
+    {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = configs[i][0];
+        attr.config = configs[i][1];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.inherit = 1;
+
+        fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+#else
+    for(int i = 0; i < COUNTERS; i++)
+        fds[i] = -1;
+#endif
+}
+
+/** \brief Stops counting, and fills `counts` with what was counted, or -1.
+ */
+static void counters_stop(int fds[COUNTERS], long long counts[COUNTERS])
+{
+    for(int i = 0; i < COUNTERS; i++)
+    {
+        counts[i] = -1;
+        if(fds[i] < 0) continue;
+
+        long long count;
+        if(read(fds[i], &count, sizeof(count)) == sizeof(count))
+            counts[i] = count;
+
+        close(fds[i]);
+    }
+}
+
+static size_t count_floors(const map_t* map)
+{
+    size_t count = 0;
+    for(size_t i = 0; i < map->size; i++)
+        count += __builtin_popcount(map->bits[i]);
+
+    return count;
+}
+
+/** \brief Generates and saves one maze, and prints the results. Runs in
+ *  a child process.
+ */
+static void run(const maze_params_t* params)
+{
+    maze_t maze;
+    if(!maze_init(&maze, params))
+    {
+        maze_free(&maze);
+        _exit(EXIT_FAILURE);
+    }
+
+    int fds[COUNTERS];
+    long long counts[COUNTERS];
+    counters_start(fds);
+
+    double start = seconds();
+
+    bool generated = true;
+    if(params->mode == MODE_KRUSKAL)
+        generated = kruskal_run(&maze, params->heads);
+    else
+        generated = maze_run(&maze);
+
+    double generate = seconds() - start;
+    counters_stop(fds, counts);
+
+    maze_stats_t stats;
+    maze_get_stats(&maze, &stats);
+    double branch = stats.branch_ns * 1e-9;
+
+    start = seconds();
+    bool saved = generated && image_save(&maze.map, outfile, IMAGE_BMP, 1);
+    double output = seconds() - start;
+    remove(outfile);
+
+    size_t steps = (size_t)params->width * params->height;
+    const char* layout = layout_names[params->layout];
+    size_t cells = count_floors(&maze.map);
+    size_t peak_branches = maze.peak_branches;
+    maze_free(&maze);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    if(json)
+    {
+        printf("%s  {\"mode\": \"%s\", \"size\": %d, \"step\": %d, \"heads\": %d, \"switch\": %d, \"seed\": %ld, "
+               "\"steps\": %zu, \"cells\": %zu, \"generate_s\": %.6f, \"update_s\": %.6f, \"branch_s\": %.6f, "
+               "\"output_s\": %.6f, \"cells_per_s\": %.0f, \"steps_per_s\": %.0f, \"peak_branches\": %zu, \"peak_rss_kb\": %ld, \"saved\": %s, "
+               "\"height\": %d, \"layout\": \"%s\", \"cache_misses\": %lld, \"l1d_misses\": %lld, \"dtlb_misses\": %lld}",
+               first ? "" : ",\n", mode_names[params->mode], params->width, params->step, params->heads, params->switch_chance,
+               params->seed, steps, cells, generate, generate - branch, branch, output,
+               cells / generate, steps / generate, peak_branches, usage.ru_maxrss, saved ? "true" : "false",
+               params->height, layout, counts[COUNTER_CACHE], counts[COUNTER_L1D], counts[COUNTER_DTLB]);
+    }
+    else
+    {
+        printf("%s,%d,%d,%d,%d,%ld,%zu,%zu,%.6f,%.6f,%.6f,%.6f,%.0f,%.0f,%zu,%ld,%d,%d,%s,%lld,%lld,%lld\n",
+               mode_names[params->mode], params->width, params->step, params->heads, params->switch_chance,
+               params->seed, steps, cells, generate, generate - branch, branch, output,
+               cells / generate, steps / generate, peak_branches, usage.ru_maxrss, saved,
+               params->height, layout, counts[COUNTER_CACHE], counts[COUNTER_L1D], counts[COUNTER_DTLB]);
+    }
+
+    fflush(stdout);
+    _exit(saved ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+int main(int argc, char** argv)
+{
+    list_t modes = {{MODE_RANDOM_SWITCHING, MODE_DEPTH_FIRST, MODE_BREADTH_FIRST, MODE_KRUSKAL}, 4};
+    list_t sizes = {{500, 2000}, 2};
+    list_t heights = {{0}, 0};
+    list_t layouts = {{MAZE_LAYOUT_ROWS}, 1};
+    list_t steps = {{2, 3}, 2};
+    list_t heads = {{1, 4}, 2};
+    list_t switches = {{10, 100}, 2};
+    long seed = 1;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-h") == 0)
+        {
+            printf("usage: bench-maze [options]\n");
+            printf("  -modes <names>       Modes to run, e.g. 'random,depth'. Default all.\n");
+            printf("  -sizes <list>        Width and height of the mazes. Default 500,2000.\n");
+            printf("  -heights <list>      Heights of the mazes, if they aren't square, such as 100 for wide mazes.\n");
+            printf("  -layouts <names>     Layouts to run, 'rows' and or 'blocks'. Default rows.\n");
+            printf("  -steps <list>        Step sizes. Default 2,3.\n");
+            printf("  -heads <list>        Numbers of heads, or of threads in 'kruskal' mode. Default 1,4.\n");
+            printf("  -switch <list>       Switch chances, only used in 'random' mode. Default 10,100.\n");
+            printf("  -seed <seed>         Seed of every run. Default 1.\n");
+            printf("  -json                Prints a JSON array instead of CSV.\n");
+            printf("  -o <path>            Temporary file the mazes are saved to. Default 'bench.bmp'.\n");
+            return EXIT_SUCCESS;
+        }
+        else if(i + 1 < argc && strcmp(argv[i], "-modes") == 0) parse_modes(&modes, argv[++i]);
+        else if(i + 1 < argc && strcmp(argv[i], "-sizes") == 0) parse_list(&sizes, argv[++i]);
+        else if(i + 1 < argc && strcmp(argv[i], "-heights") == 0) parse_list(&heights, argv[++i]);
+        else if(i + 1 < argc && strcmp(argv[i], "-layouts") == 0) parse_layouts(&layouts, argv[++i]);
+        else if(i + 1 < argc && strcmp(argv[i], "-steps") == 0) parse_list(&steps, argv[++i]);
+        else if(i + 1 < argc && strcmp(argv[i], "-heads") == 0) parse_list(&heads, argv[++i]);
+        else if(i + 1 < argc && strcmp(argv[i], "-switch") == 0) parse_list(&switches, argv[++i]);
+        else if(i + 1 < argc && strcmp(argv[i], "-seed") == 0) seed = atol(argv[++i]);
+        else if(i + 1 < argc && strcmp(argv[i], "-o") == 0) outfile = argv[++i];
+        else if(strcmp(argv[i], "-json") == 0) json = true;
+    }
+
+    if(json)
+        printf("[\n");
+    else
+        printf("mode,size,step,heads,switch,seed,steps,cells,generate_s,update_s,branch_s,output_s,cells_per_s,steps_per_s,peak_branches,peak_rss_kb,saved,height,layout,cache_misses,l1d_misses,dtlb_misses\n");
+
+    fflush(stdout);
+
+    int status = EXIT_SUCCESS;
+    maze_params_t params;
+    maze_default_params(&params);
+    params.seed = seed;
+
+    // Without heights, each maze is as high as it is wide.
+    if(heights.length == 0)
+        heights.length = 1;
+
+    for(int m = 0; m < modes.length; m++)
+    for(int l = 0; l < layouts.length; l++)
+    for(int s = 0; s < sizes.length; s++)
+    for(int r = 0; r < heights.length; r++)
+    for(int t = 0; t < steps.length; t++)
+    for(int h = 0; h < heads.length; h++)
+    for(int w = 0; w < switches.length; w++)
+    {
+        params.mode = modes.values[m];
+        params.layout = layouts.values[l];
+        params.width = sizes.values[s];
+        params.height = heights.values[r] ? heights.values[r] : sizes.values[s];
+        params.step = steps.values[t];
+        params.heads = heads.values[h];
+        params.switch_chance = switches.values[w];
+
+        // The switch chance only matters in random mode.
+        if(params.mode != MODE_RANDOM_SWITCHING)
+        {
+            if(w > 0) continue;
+            params.switch_chance = 0;
+        }
+
+        pid_t child = fork();
+        if(child == 0) run(&params);
+
+        int child_status = EXIT_FAILURE;
+        if(child < 0 || waitpid(child, &child_status, 0) < 0 || child_status != 0)
+        {
+            fprintf(stderr, "bench: run failed (mode %s, size %d, step %d, heads %d)\n",
+                    mode_names[params.mode], params.width, params.step, params.heads);
+            status = EXIT_FAILURE;
+        }
+
+        first = false;
+    }
+
+    if(json) printf("\n]\n");
+
+    return status;
+}
@@ -0,0 +1,69 @@
+
+/** bench/rng.c, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * Compares the speed of rng_below() with `rand() % n`.
+ *
+ *  cc -O2 -Isrc -o rng-bench bench/rng.c src/rng.c
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "rng.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#define CALLS 100000000
+
+static double seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char** argv)
+{
+    // Read the bound at run time, so the compiler can't fold the modulo.
+    unsigned n = (argc > 1) ? atoi(argv[1]) : 100;
+    unsigned sum = 0;
+
+    srand(1);
+    double start = seconds();
+    for(long i = 0; i < CALLS; i++)
+        sum += rand() % n;
+
+    double libc = seconds() - start;
+
+    rng_t rng;
+    rng_seed(&rng, 1, 0);
+    start = seconds();
+    for(long i = 0; i < CALLS; i++)
+        sum += rng_below(&rng, n);
+
+    double own = seconds() - start;
+
+    printf("n = %u, %d calls\n", n, CALLS);
+    printf("rand() %% n       %6.2f ns/call\n", libc / CALLS * 1e9);
+    printf("rng_below(n)     %6.2f ns/call\n", own / CALLS * 1e9);
+    printf("(checksum %u)\n", sum);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,183 @@
+
+/** arena.c, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "arena.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+
+/// Each block starts with a header, which keeps `reserved` 0 for blocks
+/// from `realloc()`. It takes 16 bytes so blocks stay aligned.
+typedef struct block_s {
+    size_t reserved;
+    size_t padding;
+} block_t;
+
+static size_t page_size()
+{
+    long size = sysconf(_SC_PAGESIZE);
+    return size > 0 ? (size_t)size : 4096;
+}
+
+static void arena_count(size_t* counter, size_t amount)
+{
+    __atomic_add_fetch(counter, amount, __ATOMIC_RELAXED);
+}
+
+/** \brief Moves the count of bytes used from `old_size` to `new_size`,
+ *  and raises the peak if it was passed.
+ */
+static void arena_use(arena_t* self, size_t old_size, size_t new_size)
+{
+    size_t used = __atomic_add_fetch(&self->used, new_size - old_size, __ATOMIC_RELAXED);
+    size_t peak = __atomic_load_n(&self->peak, __ATOMIC_RELAXED);
+
+    while(used > peak && !__atomic_compare_exchange_n(&self->peak, &peak, used, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+/** \brief Reserves `reserved` bytes of address space for a block, or
+ *  returns NULL.
+ */
+static block_t* block_reserve(size_t reserved)
+{
+    // Pages aren't backed by memory, or counted against it, until they
+    // are written.
+    void* range = mmap(NULL, reserved, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(range == MAP_FAILED)
+        return NULL;
+
+    block_t* block = range;
+    block->reserved = reserved;
+    return block;
+}
+
+static void block_free(block_t* block)
+{
+    if(block->reserved)
+        munmap(block, block->reserved);
+    else
+        free(block);
+}
+
+static void* arena_resize(void* context, void* data, size_t old_size, size_t new_size)
+{
+    arena_t* self = context;
+    block_t* block = data ? (block_t*)data - 1 : NULL;
+
+    if(new_size == 0)
+    {
+        if(block != NULL)
+        {
+            block_free(block);
+            arena_count(&self->frees, 1);
+            arena_use(self, old_size, 0);
+        }
+
+        return NULL;
+    }
+
+    if(new_size > SIZE_MAX - sizeof(block_t) - self->reserve)
+        return NULL;
+
+    size_t needed = sizeof(block_t) + new_size;
+
+    // Still fits where it is.
+    if(block != NULL && needed <= block->reserved)
+    {
+        arena_use(self, old_size, new_size);
+        return data;
+    }
+
+    // A new block, or one which outgrew its range: reserve enough for it
+    // to double a few more times.
+    size_t reserved = self->reserve;
+    while(reserved < needed)
+        reserved *= 2;
+
+    block_t* moved = block_reserve(reserved);
+
+    if(moved == NULL)
+    {
+        // No address space left, so fall back to the heap.
+        if(block != NULL && block->reserved == 0)
+        {
+            moved = realloc(block, needed);
+            if(moved == NULL) return NULL;
+
+            arena_count(&self->moves, 1);
+            arena_use(self, old_size, new_size);
+            return moved + 1;
+        }
+
+        if((moved = malloc(needed)) == NULL)
+            return NULL;
+
+        moved->reserved = 0;
+    }
+
+    if(block != NULL)
+    {
+        memcpy(moved + 1, data, old_size);
+        block_free(block);
+        arena_count(&self->moves, 1);
+    }
+    else
+    {
+        arena_count(&self->allocations, 1);
+    }
+
+    arena_use(self, old_size, new_size);
+    return moved + 1;
+}
+
+void arena_init(arena_t* self, size_t reserve)
+{
+    self->allocations = 0;
+    self->moves = 0;
+    self->frees = 0;
+    self->used = 0;
+    self->peak = 0;
+
+    arena_set_reserve(self, reserve);
+}
+
+void arena_set_reserve(arena_t* self, size_t reserve)
+{
+    size_t page = page_size();
+
+    if(reserve < page) reserve = page;
+    self->reserve = (reserve + page - 1) / page * page;
+}
+
+blist_allocator_t arena_allocator(arena_t* self)
+{
+    blist_allocator_t allocator = {arena_resize, self};
+    return allocator;
+}
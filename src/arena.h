@@ -0,0 +1,82 @@
+
+/** arena.h, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * An allocator for lists which only grow, such as the branches of a head.
+ *
+ * Each block gets its own range of address space, reserved up front but
+ * not backed by memory until its pages are first written. Growing a block
+ * inside its range is free: no call into the kernel, no copy, and the
+ * block never moves. The memory a list takes is then only what it has
+ * written, rather than the whole capacity it doubled to. A block which
+ * outgrows its range is moved to one twice as big, and if address space
+ * can't be had at all, blocks fall back to `realloc()`.
+ *
+ * Blocks are independent of each other, so lists of an arena can be used
+ * from different threads at once. The counters are kept atomically.
+ */
+
+#ifndef MAZEGEN_ARENA_H
+#define MAZEGEN_ARENA_H
+
+#include "blist.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct arena_s {
+    /// Address space reserved for each new block, a whole number of pages.
+    size_t reserve;
+
+    /// Blocks made, blocks moved to a bigger range or by `realloc()`, and
+    /// blocks freed. Growing a block in place isn't counted, since it
+    /// costs nothing.
+    size_t allocations, moves, frees;
+
+    /// Bytes asked for by the blocks which are alive, and the most there
+    /// have been at once.
+    size_t used, peak;
+} arena_t;
+
+/** \brief Starts an arena which reserves `reserve` bytes for each block.
+ *
+ * \param self arena_t*
+ * \param reserve size_t
+ * \return void
+ */
+void arena_init(arena_t* self, size_t reserve);
+
+/** \brief Sets the address space reserved for blocks made from now on,
+ *  rounded up to whole pages. Existing blocks keep theirs.
+ *
+ * \param self arena_t*
+ * \param reserve size_t
+ * \return void
+ */
+void arena_set_reserve(arena_t* self, size_t reserve);
+
+/** \brief Returns an allocator for `blist_init_with()` which keeps lists
+ *  in `self`. The arena must outlive the lists.
+ *
+ * \param self arena_t*
+ * \return blist_allocator_t
+ */
+blist_allocator_t arena_allocator(arena_t* self);
+
+#endif // MAZEGEN_ARENA_H
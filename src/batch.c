@@ -0,0 +1,419 @@
+
+/** batch.c, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include "batch.h"
+#include "eller.h"
+#include "image.h"
+#include "tiled.h"
+
+#include <pthread.h>
+
+#include <stdbool.h>
+#include <ctype.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+// J O B S //
+// ======= //
+
+static void job_free(void* job)
+{
+    free(((batch_job_t*) job)->path);
+}
+
+/** \brief Returns a copy of `pattern` with its integer conversion made to
+ *  take a long, or NULL if it doesn't have exactly one. Free it afterwards.
+ */
+static char* batch_format(const char* pattern)
+{
+    size_t length = strlen(pattern);
+    char* format = malloc(length + 2);
+    if(format == NULL) return NULL;
+
+    int conversions = 0;
+    size_t n = 0;
+    for(size_t i = 0; i < length; i++)
+    {
+        format[n++] = pattern[i];
+        if(pattern[i] != '%') continue;
+
+        if(pattern[i + 1] == '%')
+        {
+            format[n++] = pattern[++i];
+            continue;
+        }
+
+        // Flags and width, but nothing which takes another argument.
+        while(pattern[i + 1] != '\0' && strchr("-+ 0", pattern[i + 1]) != NULL)
+            format[n++] = pattern[++i];
+
+        while(isdigit((unsigned char) pattern[i + 1]))
+            format[n++] = pattern[++i];
+
+        if(pattern[i + 1] != 'd' || conversions++ > 0)
+        {
+            free(format);
+            return NULL;
+        }
+
+        format[n++] = 'l';
+        format[n++] = pattern[++i];
+    }
+
+    format[n] = '\0';
+
+    if(conversions == 0)
+    {
+        free(format);
+        return NULL;
+    }
+
+    return format;
+}
+
+/** \brief Returns `format` from `batch_format()` with `number` in place
+ *  of its integer, or NULL if it couldn't be allocated. Free it afterwards.
+ */
+static char* batch_path(const char* format, long number)
+{
+    int length = snprintf(NULL, 0, format, number);
+    char* path = malloc(length + 1);
+    if(path == NULL)
+    {
+        fprintf(stderr, "batch_path() Failed to allocate path!\n");
+        return NULL;
+    }
+
+    snprintf(path, length + 1, format, number);
+    return path;
+}
+
+static bool batch_add_formatted(batch_t* self, const char* format, long seed)
+{
+    char* path = batch_path(format, seed);
+    if(path == NULL) return false;
+
+    bool ok = batch_add(self, seed, path);
+    free(path);
+    return ok;
+}
+
+// B A T C H //
+// ========= //
+
+bool batch_init(batch_t* self, const maze_params_t* params, int tile, int depth, const image_scale_t* scale, bool validate)
+{
+    self->params = *params;
+    self->tile = tile;
+    self->depth = depth;
+    self->scale = scale ? *scale : (image_scale_t){1, 1};
+    self->validate = validate;
+    self->next = 0;
+    self->failed = 0;
+    self->job_threads = 1;
+
+    self->jobs = blist_create(64, sizeof(batch_job_t));
+    if(self->jobs == NULL)
+    {
+        fprintf(stderr, "batch_init() Failed to allocate jobs list!\n");
+        return false;
+    }
+
+    self->jobs->destructor = job_free;
+    return true;
+}
+
+void batch_free(batch_t* self)
+{
+    if(self->jobs != NULL)
+        blist_destroy(self->jobs);
+
+    self->jobs = NULL;
+}
+
+bool batch_add(batch_t* self, long seed, const char* path)
+{
+    if(seed == 0)
+    {
+        fprintf(stderr, "batch_add() Seed 0 picks a random seed, so it can't be used in a batch!\n");
+        return false;
+    }
+
+    if(!image_supports(image_format_from_path(path), self->depth))
+    {
+        fprintf(stderr, "batch_add() %d-bit images can't be saved as '%s'!\n", self->depth, path);
+        return false;
+    }
+
+    if(image_format_from_path(path) == IMAGE_TREE && (self->scale.floor != 1 || self->scale.wall != 1))
+    {
+        fprintf(stderr, "batch_add() .mzt files can't be scaled, so '%s' can't be saved!\n", path);
+        return false;
+    }
+
+    batch_job_t job = {seed, malloc(strlen(path) + 1), {0, 0, 0, 0}};
+    if(job.path == NULL)
+    {
+        fprintf(stderr, "batch_add() Failed to allocate path!\n");
+        return false;
+    }
+
+    strcpy(job.path, path);
+
+    if(!blist_push(self->jobs, &job))
+    {
+        fprintf(stderr, "batch_add() Failed to grow jobs list!\n");
+        free(job.path);
+        return false;
+    }
+
+    return true;
+}
+
+bool batch_add_range(batch_t* self, long first, long last, const char* pattern)
+{
+    if(first > last)
+    {
+        fprintf(stderr, "batch_add_range() The first seed %ld is after the last seed %ld!\n", first, last);
+        return false;
+    }
+
+    char* format = batch_format(pattern);
+    if(format == NULL)
+    {
+        fprintf(stderr, "batch_add_range() The output path '%s' needs one %%d for the seed!\n", pattern);
+        return false;
+    }
+
+    bool ok = true;
+    for(long seed = first; ok; seed++)
+    {
+        ok = batch_add_formatted(self, format, seed);
+        if(seed == last) break;
+    }
+
+    free(format);
+    return ok;
+}
+
+bool batch_add_manifest(batch_t* self, const char* manifest, const char* pattern)
+{
+    FILE* file = fopen(manifest, "r");
+    if(file == NULL)
+    {
+        fprintf(stderr, "batch_add_manifest() Failed to open '%s'!\n", manifest);
+        return false;
+    }
+
+    // Only needed by lines without a path.
+    char* format = batch_format(pattern);
+
+    char line[4096];
+    bool ok = true;
+    for(int number = 1; ok && fgets(line, sizeof(line), file) != NULL; number++)
+    {
+        size_t length = strlen(line);
+        if(length == sizeof(line) - 1 && line[length - 1] != '\n' && !feof(file))
+        {
+            fprintf(stderr, "batch_add_manifest() Line %d of '%s' is too long!\n", number, manifest);
+            ok = false;
+            break;
+        }
+
+        // Trim the line.
+        while(length > 0 && isspace((unsigned char) line[length - 1]))
+            line[--length] = '\0';
+
+        char* start = line;
+        while(isspace((unsigned char) *start)) start++;
+
+        if(*start == '\0' || *start == '#') continue;
+
+        char* end;
+        long seed = strtol(start, &end, 10);
+        if(end == start || (*end != '\0' && !isspace((unsigned char) *end)))
+        {
+            fprintf(stderr, "batch_add_manifest() Line %d of '%s' doesn't start with a seed!\n", number, manifest);
+            ok = false;
+            break;
+        }
+
+        while(isspace((unsigned char) *end)) end++;
+
+        if(*end != '\0')
+        {
+            ok = batch_add(self, seed, end);
+        }
+        else if(format != NULL)
+        {
+            ok = batch_add_formatted(self, format, seed);
+        }
+        else
+        {
+            fprintf(stderr, "batch_add_manifest() Line %d of '%s' has no path, and the output path '%s' has no %%d for the seed!\n", number, manifest, pattern);
+            ok = false;
+        }
+    }
+
+    free(format);
+    fclose(file);
+    return ok;
+}
+
+bool batch_add_regions(batch_t* self, const tiled_region_t* regions, int count, const char* pattern)
+{
+    if(!self->tile)
+    {
+        fprintf(stderr, "batch_add_regions() Regions can only be cut from a tiled maze!\n");
+        return false;
+    }
+
+    char* format = NULL;
+    if(count > 1 && (format = batch_format(pattern)) == NULL)
+    {
+        fprintf(stderr, "batch_add_regions() The output path '%s' needs one %%d for the number of the region!\n", pattern);
+        return false;
+    }
+
+    bool ok = true;
+    for(int i = 0; ok && i < count; i++)
+    {
+        char* path = format ? batch_path(format, i + 1) : NULL;
+        if(format && path == NULL)
+        {
+            ok = false;
+            break;
+        }
+
+        ok = batch_add(self, self->params.seed, path ? path : pattern);
+        if(ok)
+        {
+            batch_job_t* job = blist_get(self->jobs, self->jobs->length - 1);
+            job->region = regions[i];
+        }
+
+        free(path);
+    }
+
+    free(format);
+    return ok;
+}
+
+// G E N E R A T I O N //
+// =================== //
+
+/** \brief Generates and saves the maze of `job` in `maze`, which is
+ *  initialised by the first job of each thread and reset by the others.
+ */
+static bool batch_make(batch_t* self, maze_t* maze, bool* ready, const batch_job_t* job)
+{
+    maze_params_t params = self->params;
+    params.seed = job->seed;
+
+    int format = image_format_from_path(job->path);
+
+    // Streamed mazes go straight to the file, with nothing to reuse.
+    if(params.mode == MODE_ELLER)
+        return eller_generate(&params, job->path, format, self->depth, &self->scale);
+
+    if(job->region.x1 != 0)
+        return tiled_generate_region(&params, self->tile, self->job_threads, &job->region, job->path, format, self->depth);
+
+    if(self->tile)
+        return tiled_generate(&params, self->tile, self->job_threads, job->path, format, self->depth, &self->scale);
+
+    bool ok = *ready ? maze_reset(maze, &params) : maze_init(maze, &params);
+    *ready = true;
+
+    if(!ok)
+    {
+        fprintf(stderr, "batch_make() Failed to initialise maze with seed %ld!\n", job->seed);
+        return false;
+    }
+
+    if(!maze_run(maze))
+    {
+        fprintf(stderr, "batch_make() Failed to generate maze with seed %ld!\n", job->seed);
+        return false;
+    }
+
+    if(self->validate && !maze_validate(maze))
+    {
+        fprintf(stderr, "batch_make() The maze with seed %ld is not a perfect maze!\n", job->seed);
+        return false;
+    }
+
+    return image_save_maze(maze, job->path, format, self->depth, &self->scale);
+}
+
+static void* batch_work(void* data)
+{
+    batch_t* self = data;
+
+    maze_t maze;
+    bool ready = false;
+
+    for(;;)
+    {
+        size_t i = __atomic_fetch_add(&self->next, 1, __ATOMIC_RELAXED);
+        if(i >= self->jobs->length) break;
+
+        if(!batch_make(self, &maze, &ready, blist_get(self->jobs, i)))
+            __atomic_fetch_add(&self->failed, 1, __ATOMIC_RELAXED);
+    }
+
+    if(ready) maze_free(&maze);
+    return NULL;
+}
+
+bool batch_run(batch_t* self, int threads)
+{
+    self->next = 0;
+    self->failed = 0;
+
+    if((size_t)threads > self->jobs->length)
+    {
+        self->job_threads = self->jobs->length ? threads / self->jobs->length : 1;
+        threads = self->jobs->length ? self->jobs->length : 1;
+    }
+    else
+    {
+        self->job_threads = 1;
+    }
+
+    pthread_t* workers = malloc(threads * sizeof(pthread_t));
+    int started = 0;
+
+    if(workers != NULL)
+    {
+        for(; started < threads - 1; started++)
+        {
+            if(pthread_create(&workers[started], NULL, batch_work, self) != 0)
+                break;
+        }
+    }
+
+    batch_work(self);
+
+    for(int i = 0; i < started; i++)
+        pthread_join(workers[i], NULL);
+
+    free(workers);
+    return self->failed == 0;
+}
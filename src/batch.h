@@ -0,0 +1,139 @@
+
+/** batch.h, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * Generates many mazes in one process.
+ *
+ * A batch is a list of jobs, each a seed and the path of the image to
+ * save it to. The jobs are shared out between threads, and each thread
+ * reuses one maze, so its map and branches lists are only allocated once.
+ * Each maze is exactly the maze a single run with its seed would make.
+ *
+ * A job can also save just a region of a tiled maze, so many windows of
+ * one huge maze can be made at once.
+ */
+
+#ifndef MAZEGEN_BATCH_H
+#define MAZEGEN_BATCH_H
+
+#include "blist.h"
+#include "image.h"
+#include "maze.h"
+#include "tiled.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct batch_job_s {
+    long seed;
+    char* path;
+
+    /// The region of the maze to save, unless `region.x1` is 0.
+    tiled_region_t region;
+} batch_job_t;
+
+typedef struct batch_s {
+    /// Options of every maze, apart from the seed.
+    maze_params_t params;
+
+    /// Tile size passed to `tiled_generate()`, or 0 to generate whole mazes.
+    int tile;
+    int depth;
+    image_scale_t scale;
+    bool validate;
+
+    blist_t* jobs;
+
+    /// Next job to be run, and the number of jobs which failed.
+    size_t next, failed;
+
+    /// Threads each tiled maze or region is generated on. There are more
+    /// than one when there are more threads than jobs.
+    int job_threads;
+} batch_t;
+
+/** \brief Initialises an empty batch of mazes with the options in
+ *  `params`. Call `batch_free()` afterwards, even if this fails.
+ *
+ * \param self batch_t*
+ * \param params const maze_params_t*
+ * \param tile int
+ * \param depth int
+ * \param scale const image_scale_t*
+ * \param validate bool
+ * \return bool
+ */
+bool batch_init(batch_t* self, const maze_params_t* params, int tile, int depth, const image_scale_t* scale, bool validate);
+void batch_free(batch_t* self);
+
+/** \brief Adds the maze with `seed`, to be saved to `path`.
+ *
+ * \param self batch_t*
+ * \param seed long
+ * \param path const char*
+ * \return bool
+ */
+bool batch_add(batch_t* self, long seed, const char* path);
+
+/** \brief Adds the mazes with seeds `first` to `last`, both included.
+ *  Each is saved to `pattern`, with its seed in place of the pattern's
+ *  one printf style integer, such as `%d` or `%06d`.
+ *
+ * \param self batch_t*
+ * \param first long
+ * \param last long
+ * \param pattern const char*
+ * \return bool
+ */
+bool batch_add_range(batch_t* self, long first, long last, const char* pattern);
+
+/** \brief Adds the mazes listed in the file at `manifest`. Each line has
+ *  a seed, and optionally the path to save that maze to. Mazes without a
+ *  path are saved to `pattern`, as in `batch_add_range()`. Blank lines,
+ *  and lines starting with '#', are skipped.
+ *
+ * \param self batch_t*
+ * \param manifest const char*
+ * \param pattern const char*
+ * \return bool
+ */
+bool batch_add_manifest(batch_t* self, const char* manifest, const char* pattern);
+
+/** \brief Adds the `count` regions of the tiled maze with the batch's
+ *  own seed. A single region is saved to `pattern` itself, and several
+ *  to `pattern` with their number, from 1, in place of its one integer.
+ *
+ * \param self batch_t*
+ * \param regions const tiled_region_t*
+ * \param count int
+ * \param pattern const char*
+ * \return bool
+ */
+bool batch_add_regions(batch_t* self, const tiled_region_t* regions, int count, const char* pattern);
+
+/** \brief Generates and saves every maze of the batch, on `threads`
+ *  threads. Returns false if any maze failed, after trying the rest.
+ *
+ * \param self batch_t*
+ * \param threads int
+ * \return bool
+ */
+bool batch_run(batch_t* self, int threads);
+
+#endif // MAZEGEN_BATCH_H
@@ -27,9 +27,25 @@
 #include "blist.h"
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdio.h>
 
+/** \brief Resizes the array of the list with its allocator.
+ */
+static void* blist_resize(blist_t* self, size_t old_size, size_t new_size)
+{
+    if(self->allocator.resize != NULL)
+        return self->allocator.resize(self->allocator.context, self->array, old_size, new_size);
+
+    if(new_size == 0)
+    {
+        free(self->array);
+        return NULL;
+    }
+
+    return realloc(self->array, new_size);
+}
 
 blist_t* blist_new()
 {
@@ -38,31 +54,42 @@ blist_t* blist_new()
 
 bool blist_init(blist_t* self, size_t capacity, size_t size)
 {
+    blist_allocator_t allocator = {NULL, NULL};
+    return blist_init_with(self, capacity, size, allocator);
+}
+
+bool blist_init_with(blist_t* self, size_t capacity, size_t size, blist_allocator_t allocator)
+{
+    self->array = NULL;
+    self->length = 0;
+    self->capacity = 0;
+    self->size = size;
+    self->destructor = NULL;
+    self->allocator = allocator;
+
     if(capacity)
     {
-        self->array = malloc(capacity * size);
-        if(self->array == NULL)
+        if(capacity > SIZE_MAX / size || (self->array = blist_resize(self, 0, capacity * size)) == NULL)
         {
             fprintf(stderr, "blist_init() Failed to allocate list array!\n");
             return false;
         }
     }
-    else
-    {
-        self->array = NULL;
-    }
 
-    self->length = 0;
     self->capacity = capacity;
-    self->size = size;
-    self->destructor = NULL;
     return true;
 }
 
 blist_t* blist_create(size_t capacity, size_t size)
+{
+    blist_allocator_t allocator = {NULL, NULL};
+    return blist_create_with(capacity, size, allocator);
+}
+
+blist_t* blist_create_with(size_t capacity, size_t size, blist_allocator_t allocator)
 {
     blist_t* self = blist_new();
-    if(self != NULL && !blist_init(self, capacity, size))
+    if(self != NULL && !blist_init_with(self, capacity, size, allocator))
     {
         free(self);
         self = NULL;
@@ -79,24 +106,48 @@ void blist_destroy(blist_t* self)
             self->destructor(blist_get(self, i));
     }
 
-    free(self->array);
-    self->array = NULL;
+    blist_release(self);
 
     free(self);
     self = NULL;
 }
 
-void blist_extend(blist_t* self)
+void blist_release(blist_t* self)
 {
-    self->capacity = (self->capacity) ? self->capacity << 1 : 10;
-    self->array = realloc(self->array, self->capacity * self->size);
+    if(self->array != NULL)
+        blist_resize(self, self->capacity * self->size, 0);
+
+    self->array = NULL;
+    self->length = 0;
+    self->capacity = 0;
+}
+
+bool blist_extend(blist_t* self)
+{
+    size_t capacity = (self->capacity) ? self->capacity << 1 : 10;
+    unsigned char* array = NULL;
+
+    if(capacity <= SIZE_MAX / self->size)
+        array = blist_resize(self, self->capacity * self->size, capacity * self->size);
+
+    if(array == NULL)
+    {
+        fprintf(stderr, "blist_extend() Failed to grow list to %zu elements!\n", capacity);
+        return false;
+    }
+
+    self->array = array;
+    self->capacity = capacity;
+    return true;
 }
 
-void blist_push(blist_t* self, void* data)
+bool blist_push(blist_t* self, void* data)
 {
-    if(self->length == self->capacity) blist_extend(self);
+    if(self->length == self->capacity && !blist_extend(self))
+        return false;
 
     blist_set(self, self->length++, data);
+    return true;
 }
 
 void blist_pop(blist_t* self)
@@ -123,9 +174,50 @@ void blist_remove(blist_t* self, size_t index)
     self->length--;
 }
 
+void blist_swap_remove(blist_t* self, size_t index)
+{
+    char* i = blist_get(self, index);
+    if(self->destructor != NULL)
+        self->destructor(i);
+
+    // Move the last element into the hole.
+    if(index != self->length - 1)
+        memcpy(i, blist_get(self, self->length - 1), self->size);
+
+    self->length--;
+}
+
+void blist_shift(blist_t* self, size_t count)
+{
+    if(count > self->length) count = self->length;
+
+    if(self->destructor != NULL)
+    {
+        for(size_t i = 0; i < count; i++)
+            self->destructor(blist_get(self, i));
+    }
+
+    memmove(self->array, blist_get(self, count), (self->length - count) * self->size);
+    self->length -= count;
+}
+
+void blist_clear(blist_t* self)
+{
+    if(self->destructor != NULL)
+    {
+        for(size_t i = 0; i < self->length; i++)
+            self->destructor(blist_get(self, i));
+    }
+
+    self->length = 0;
+}
+
 void blist_set(blist_t* self, size_t index, void* data)
 {
-    if(index >= self->capacity) blist_extend(self);
+    while(index >= self->capacity)
+    {
+        if(!blist_extend(self)) return;
+    }
 
     memcpy(blist_get(self, index), data, self->size);
 }
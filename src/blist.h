@@ -34,6 +34,16 @@
 #include <stdbool.h>
 #include <stdlib.h>
 
+/// Where a list gets the memory for its array. `resize` works like
+/// `realloc()`, but is also told how big `block` was: it returns `block`
+/// or a new block with room for `new_size` bytes and the first
+/// `old_size` bytes moved over, or NULL if that fails, leaving `block`
+/// as it was. A `new_size` of 0 frees `block` and returns NULL.
+typedef struct blist_allocator_s {
+    void* (*resize)(void* context, void* block, size_t old_size, size_t new_size);
+    void* context;
+} blist_allocator_t;
+
 typedef struct blist_s {
     unsigned char* array;
     size_t length, capacity, size;
@@ -41,6 +51,9 @@ typedef struct blist_s {
     /// If `destructor` is not NULL, each element is
     /// passed to it when calling `blist_destroy()`.
     void (*destructor)(void*);
+
+    /// If `allocator.resize` is NULL, the array is kept with `realloc()`.
+    blist_allocator_t allocator;
 } blist_t;
 
 blist_t* blist_new();
@@ -48,14 +61,52 @@ bool blist_init(blist_t* self, size_t capacity, size_t size);
 blist_t* blist_create(size_t capacity, size_t size);
 void blist_destroy(blist_t* self);
 
+/** \brief Like `blist_init()`, with the array kept by `allocator`.
+ *
+ * \param self blist_t*
+ * \param capacity size_t
+ * \param size size_t
+ * \param allocator blist_allocator_t
+ * \return bool
+ */
+bool blist_init_with(blist_t* self, size_t capacity, size_t size, blist_allocator_t allocator);
+
+/** \brief Like `blist_create()`, with the array kept by `allocator`.
+ *
+ * \param capacity size_t
+ * \param size size_t
+ * \param allocator blist_allocator_t
+ * \return blist_t*
+ */
+blist_t* blist_create_with(size_t capacity, size_t size, blist_allocator_t allocator);
+
+/** \brief Frees the array of the list, but not the list itself, for
+ *  lists set up with `blist_init()`. Elements are not passed to
+ *  `destructor`.
+ *
+ * \param self blist_t*
+ * \return void
+ */
+void blist_release(blist_t* self);
+
 /** \brief Copies `list->size` bytes from `data` to the end of the list.
+ *  Returns false, leaving the list as it was, if it is full and can't
+ *  grow.
  *
  * \param list blist_t*
  * \param data void*
  * \param size size_t
- * \return void
+ * \return bool
  */
-void blist_push(blist_t* self, void* data);
+bool blist_push(blist_t* self, void* data);
+
+/** \brief Doubles the capacity of the list. Returns false, leaving the
+ *  list as it was, if there isn't enough memory.
+ *
+ * \param self blist_t*
+ * \return bool
+ */
+bool blist_extend(blist_t* self);
 
 /** \brief Removes the last element from the list. If `destructor` is
  *  not NULL, the element is passed to it.
@@ -76,6 +127,35 @@ void blist_pop(blist_t* self);
  */
 void blist_remove(blist_t* self, size_t index);
 
+/** \brief Removes the element at `index` by moving the last element
+ *  into its place. Does not preserve the order of the list, but
+ *  runs in constant time. If `destructor` is not NULL, the element
+ *  is passed to it.
+ *
+ * \param self blist_t*
+ * \param index size_t
+ * \return void
+ */
+void blist_swap_remove(blist_t* self, size_t index);
+
+/** \brief Removes the first `count` elements and moves the rest to
+ *  the front of the list with a single copy. If `destructor` is not
+ *  NULL, each removed element is passed to it.
+ *
+ * \param self blist_t*
+ * \param count size_t
+ * \return void
+ */
+void blist_shift(blist_t* self, size_t count);
+
+/** \brief Removes every element, keeping the memory of the list. If
+ *  `destructor` is not NULL, each element is passed to it.
+ *
+ * \param self blist_t*
+ * \return void
+ */
+void blist_clear(blist_t* self);
+
 /** \brief Copies `list->size` bytes from `data` into the list at `index`.
  *
  * \param list blist_t*
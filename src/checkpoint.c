@@ -0,0 +1,283 @@
+
+/** checkpoint.c, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "checkpoint.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#define CHECKPOINT_ORDER 0x01020304
+
+static void put_u16(unsigned char* p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put_u32(unsigned char* p, uint32_t v)
+{
+    put_u16(p, v & 0xFFFF);
+    put_u16(p + 2, v >> 16);
+}
+
+static uint16_t get_u16(const unsigned char* p)
+{
+    return p[0] | p[1] << 8;
+}
+
+static uint32_t get_u32(const unsigned char* p)
+{
+    return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t clock_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// F I L E //
+// ======= //
+
+static bool checkpoint_write_header(const maze_params_t* params, FILE* file)
+{
+    unsigned char header[CHECKPOINT_HEADER_SIZE] = {0};
+    uint32_t order = CHECKPOINT_ORDER;
+
+    memcpy(header, CHECKPOINT_MAGIC, 4);
+    put_u16(header + 4, CHECKPOINT_VERSION);
+    put_u16(header + 6, CHECKPOINT_HEADER_SIZE);
+    put_u32(header + 8, params->width);
+    put_u32(header + 12, params->height);
+    put_u32(header + 16, params->step);
+    put_u32(header + 20, params->heads);
+    put_u32(header + 24, params->mode);
+    put_u32(header + 28, params->switch_chance);
+    put_u32(header + 32, (params->ordered ? 1 : 0) | (params->layout == MAZE_LAYOUT_BLOCKS ? 2 : 0));
+    memcpy(header + 36, &order, 4);
+    put_u32(header + 40, (uint64_t)params->seed & 0xFFFFFFFF);
+    put_u32(header + 44, (uint64_t)params->seed >> 32);
+    header[48] = sizeof(size_t);
+    header[49] = sizeof(int);
+
+    return fwrite(header, sizeof(header), 1, file) == 1;
+}
+
+/** \brief Reads and checks the header of the checkpoint at `path`,
+ *  leaving `file` just after it.
+ */
+static FILE* checkpoint_open(const char* path, maze_params_t* params)
+{
+    FILE* file = fopen(path, "rb");
+    if(file == NULL)
+    {
+        fprintf(stderr, "checkpoint_open() Failed to open '%s'!\n", path);
+        return NULL;
+    }
+
+    unsigned char header[CHECKPOINT_HEADER_SIZE];
+    uint32_t order;
+
+    if(fread(header, sizeof(header), 1, file) != 1 || memcmp(header, CHECKPOINT_MAGIC, 4) != 0)
+    {
+        fprintf(stderr, "checkpoint_open() '%s' is not a checkpoint!\n", path);
+        fclose(file);
+        return NULL;
+    }
+
+    memcpy(&order, header + 36, 4);
+    if(get_u16(header + 4) != CHECKPOINT_VERSION || get_u16(header + 6) != CHECKPOINT_HEADER_SIZE)
+    {
+        fprintf(stderr, "checkpoint_open() '%s' is from another version!\n", path);
+        fclose(file);
+        return NULL;
+    }
+
+    if(order != CHECKPOINT_ORDER || header[48] != sizeof(size_t) || header[49] != sizeof(int))
+    {
+        fprintf(stderr, "checkpoint_open() '%s' was written by a different kind of machine!\n", path);
+        fclose(file);
+        return NULL;
+    }
+
+    params->width = get_u32(header + 8);
+    params->height = get_u32(header + 12);
+    params->step = get_u32(header + 16);
+    params->heads = get_u32(header + 20);
+    params->mode = get_u32(header + 24);
+    params->switch_chance = get_u32(header + 28);
+    params->ordered = get_u32(header + 32) & 1;
+    params->layout = (get_u32(header + 32) & 2) ? MAZE_LAYOUT_BLOCKS : MAZE_LAYOUT_ROWS;
+    params->seed = (int64_t)(get_u32(header + 40) | (uint64_t)get_u32(header + 44) << 32);
+
+    return file;
+}
+
+bool checkpoint_save(const maze_t* maze, const char* path)
+{
+    // Written beside the last checkpoint, then renamed over it.
+    size_t length = strlen(path);
+    char* temporary = malloc(length + 5);
+    if(temporary == NULL)
+    {
+        fprintf(stderr, "checkpoint_save() Failed to allocate path!\n");
+        return false;
+    }
+
+    memcpy(temporary, path, length);
+    memcpy(temporary + length, ".tmp", 5);
+
+    FILE* file = fopen(temporary, "wb");
+    if(file == NULL)
+    {
+        fprintf(stderr, "checkpoint_save() Failed to open '%s'!\n", temporary);
+        free(temporary);
+        return false;
+    }
+
+    bool ok = checkpoint_write_header(&maze->params, file) && maze_save_state(maze, file);
+
+    // On disk before it replaces the last one.
+    ok = fflush(file) == 0 && fsync(fileno(file)) == 0 && ok;
+    ok = fclose(file) == 0 && ok;
+    ok = ok && rename(temporary, path) == 0;
+
+    if(!ok)
+    {
+        fprintf(stderr, "checkpoint_save() Failed to write '%s'!\n", path);
+        remove(temporary);
+    }
+
+    free(temporary);
+    return ok;
+}
+
+bool checkpoint_read_params(const char* path, maze_params_t* params)
+{
+    FILE* file = checkpoint_open(path, params);
+    if(file == NULL) return false;
+
+    fclose(file);
+    return true;
+}
+
+bool checkpoint_load(maze_t* maze, const char* path)
+{
+    maze_params_t params = maze->params;
+
+    FILE* file = checkpoint_open(path, &params);
+    if(file == NULL) return false;
+
+    const maze_params_t* own = &maze->params;
+    if(params.width != own->width || params.height != own->height || params.step != own->step || params.heads != own->heads
+       || params.mode != own->mode || params.switch_chance != own->switch_chance || params.ordered != own->ordered
+       || params.layout != own->layout || params.seed != own->seed)
+    {
+        fprintf(stderr, "checkpoint_load() '%s' is of a different maze!\n", path);
+        fclose(file);
+        return false;
+    }
+
+    bool ok = maze_load_state(maze, file);
+    fclose(file);
+
+    return ok;
+}
+
+// W R I T E R //
+// =========== //
+
+void checkpoint_init(checkpoint_t* self, const char* path, double seconds)
+{
+    self->path = path;
+    self->every = seconds > 0 ? seconds * 1e9 : 0;
+    self->due = clock_ns() + self->every;
+    self->writer = 0;
+    self->written = 0;
+    self->failed = 0;
+}
+
+/** \brief Collects the writer if it has finished, or waits for it with
+ *  `wait`. Returns true once there is no writer.
+ */
+static bool checkpoint_reap(checkpoint_t* self, bool wait)
+{
+    if(self->writer == 0) return true;
+
+    int status;
+    pid_t pid = waitpid(self->writer, &status, wait ? 0 : WNOHANG);
+    if(pid == 0) return false;
+
+    // A writer which exits with a failure has said why.
+    if(pid < 0 || !WIFEXITED(status))
+        fprintf(stderr, "checkpoint_reap() The checkpoint writer for '%s' was lost!\n", self->path);
+
+    if(pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+        self->failed++;
+
+    self->writer = 0;
+    return true;
+}
+
+bool checkpoint_update(checkpoint_t* self, const maze_t* maze)
+{
+    uint64_t now = clock_ns();
+    if(now < self->due) return true;
+
+    // Rather than wait, skip a checkpoint while the last is still written.
+    if(!checkpoint_reap(self, false)) return true;
+
+    self->due = now + self->every;
+    self->written++;
+
+    // Make sure nothing buffered is written twice.
+    fflush(NULL);
+
+    pid_t pid = fork();
+    if(pid == 0)
+        _exit(checkpoint_save(maze, self->path) ? EXIT_SUCCESS : EXIT_FAILURE);
+
+    if(pid > 0)
+    {
+        self->writer = pid;
+        return true;
+    }
+
+    // Without a second process, write it here.
+    if(checkpoint_save(maze, self->path)) return true;
+
+    self->failed++;
+    return false;
+}
+
+bool checkpoint_finish(checkpoint_t* self)
+{
+    checkpoint_reap(self, true);
+    return self->failed == 0;
+}
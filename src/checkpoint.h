@@ -0,0 +1,135 @@
+
+/** checkpoint.h, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * Checkpoints of a maze being generated, so a long run which is stopped
+ * can carry on from its last checkpoint with `-resume`, and still make
+ * the maze an uninterrupted run would have.
+ *
+ * A checkpoint is a 64-byte header followed by `maze_save_state()`. The
+ * header is little-endian; the state is in the byte order and type sizes
+ * of the machine which wrote it, which the header records, so it is only
+ * read back on a machine like it.
+ *
+ *  offset  size  field
+ *       0     4  "MZCK"
+ *       4     2  version, 1
+ *       6     2  size of the header, 64
+ *       8     4  width, in steps
+ *      12     4  height, in steps
+ *      16     4  step
+ *      20     4  heads
+ *      24     4  mode
+ *      28     4  switch chance
+ *      32     4  flags, bit 0 set if `ordered`, bit 1 if MAZE_LAYOUT_BLOCKS
+ *      36     4  0x01020304 in the byte order of the state
+ *      40     8  seed, signed
+ *      48     1  sizeof(size_t) of the state
+ *      49     1  sizeof(int) of the state
+ *      50    14  zero
+ *
+ * Checkpoints are written by a forked copy of the process, which sees
+ * the maze as it was when it was forked while the original carries on,
+ * so generation only stops for as long as `fork()` takes. They are
+ * written to a temporary file first and renamed over the last one, so
+ * the last complete checkpoint survives the process being killed at any
+ * moment.
+ */
+
+#ifndef MAZEGEN_CHECKPOINT_H
+#define MAZEGEN_CHECKPOINT_H
+
+#include "maze.h"
+
+#include <sys/types.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CHECKPOINT_MAGIC "MZCK"
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_HEADER_SIZE 64
+
+typedef struct checkpoint_s {
+    const char* path;
+
+    /// Nanoseconds between checkpoints, and when the next one is due.
+    uint64_t every, due;
+
+    /// Process writing the last checkpoint, or 0.
+    pid_t writer;
+
+    /// Checkpoints started, and those which failed.
+    size_t written, failed;
+} checkpoint_t;
+
+/** \brief Starts taking checkpoints to `path` every `seconds`.
+ *
+ * \param self checkpoint_t*
+ * \param path const char*
+ * \param seconds double
+ * \return void
+ */
+void checkpoint_init(checkpoint_t* self, const char* path, double seconds);
+
+/** \brief Starts writing a checkpoint of `maze` if one is due and the last
+ *  one is finished. Call it between updates of the maze, as often as is
+ *  convenient. Returns false if it couldn't be started.
+ *
+ * \param self checkpoint_t*
+ * \param maze const maze_t*
+ * \return bool
+ */
+bool checkpoint_update(checkpoint_t* self, const maze_t* maze);
+
+/** \brief Waits for the checkpoint being written, if there is one.
+ *  Returns false if any checkpoint failed.
+ *
+ * \param self checkpoint_t*
+ * \return bool
+ */
+bool checkpoint_finish(checkpoint_t* self);
+
+/** \brief Writes a checkpoint of `maze` to `path` now, on this thread.
+ *
+ * \param maze const maze_t*
+ * \param path const char*
+ * \return bool
+ */
+bool checkpoint_save(const maze_t* maze, const char* path);
+
+/** \brief Reads the params of the maze in the checkpoint at `path`, to
+ *  give `maze_init()` before `checkpoint_load()`.
+ *
+ * \param path const char*
+ * \param params maze_params_t*
+ * \return bool
+ */
+bool checkpoint_read_params(const char* path, maze_params_t* params);
+
+/** \brief Carries `maze`, set up with the params from
+ *  `checkpoint_read_params()`, on from the checkpoint at `path`.
+ *
+ * \param maze maze_t*
+ * \param path const char*
+ * \return bool
+ */
+bool checkpoint_load(maze_t* maze, const char* path);
+
+#endif // MAZEGEN_CHECKPOINT_H
@@ -0,0 +1,242 @@
+
+/** eller.c, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+#include "eller.h"
+#include "image.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+typedef struct eller_s {
+    /// Number of steps across and down.
+    int columns, rows;
+
+    /// Set of each step of the row. Sets are numbered from 0 to
+    /// `2 * columns - 1`, which is enough for the sets carried down from
+    /// the row above plus a new one for every other step.
+    int* sets;
+
+    /// Union-find over the set numbers, while the row is being joined.
+    int* parents;
+
+    /// Per set: the last column it has in the row, whether it has opened
+    /// a passage down yet, and whether the next row uses its number.
+    int* last;
+    unsigned char* opened;
+    unsigned char* used;
+
+    /// Per column: whether the step opens a passage right, and down.
+    unsigned char* right;
+    unsigned char* down;
+
+    rng_t rng;
+    uint64_t bits;
+    int left;
+} eller_t;
+
+static bool eller_coin(eller_t* self)
+{
+    if(self->left == 0)
+    {
+        self->bits = rng_next(&self->rng);
+        self->left = 64;
+    }
+
+    self->left--;
+    return (self->bits >> self->left) & 1;
+}
+
+static int eller_find(eller_t* self, int set)
+{
+    while(self->parents[set] != set)
+    {
+        self->parents[set] = self->parents[self->parents[set]];
+        set = self->parents[set];
+    }
+
+    return set;
+}
+
+/** \brief Joins the steps of row `y`, decides which of them open down,
+ *  and gives the next row its sets.
+ */
+static void eller_row(eller_t* self, int y)
+{
+    int columns = self->columns;
+    bool last = (y == self->rows - 1);
+
+    // Join neighbours of different sets at random, or always on the last
+    // row, which has no other way to join them.
+    for(int x = 0; x < columns - 1; x++)
+    {
+        int a = eller_find(self, self->sets[x]), b = eller_find(self, self->sets[x + 1]);
+
+        self->right[x] = (a != b && (last || eller_coin(self)));
+        if(self->right[x]) self->parents[b] = a;
+    }
+
+    self->right[columns - 1] = 0;
+
+    for(int x = 0; x < columns; x++)
+        self->sets[x] = eller_find(self, self->sets[x]);
+
+    if(last)
+    {
+        memset(self->down, 0, (size_t)columns);
+        return;
+    }
+
+    // Open passages down at random, but at least one per set, which its
+    // last step opens if none of the others did.
+    for(int x = 0; x < columns; x++)
+    {
+        self->last[self->sets[x]] = x;
+        self->opened[self->sets[x]] = 0;
+    }
+
+    for(int x = 0; x < columns; x++)
+    {
+        int set = self->sets[x];
+
+        self->down[x] = eller_coin(self) || (self->last[set] == x && !self->opened[set]);
+        if(self->down[x]) self->opened[set] = 1;
+    }
+
+    // Steps below a passage stay in their set, the others get new ones.
+    memset(self->used, 0, (size_t)2 * columns);
+    for(int x = 0; x < columns; x++)
+    {
+        if(self->down[x]) self->used[self->sets[x]] = 1;
+    }
+
+    for(int x = 0, free = 0; x < columns; x++)
+    {
+        if(self->down[x]) continue;
+
+        while(self->used[free]) free++;
+
+        self->sets[x] = free;
+        self->used[free] = 1;
+    }
+
+    for(int i = 0; i < 2 * columns; i++)
+        self->parents[i] = i;
+}
+
+/** \brief Draws the current row of steps into `band`, which is one row
+ *  of steps tall.
+ */
+static void eller_draw(const eller_t* self, map_t* band, int step)
+{
+    memset(band->bits, 0, band->size);
+
+    for(int x = 0; x < self->columns; x++)
+    {
+        int left = x * step;
+        map_set(band, left, 0);
+
+        for(int k = 1; k < step && self->right[x]; k++)
+            map_set(band, left + k, 0);
+
+        for(int k = 1; k < step && self->down[x]; k++)
+            map_set(band, left, k);
+    }
+}
+
+bool eller_generate(const maze_params_t* params, const char* path, int format, int depth, const image_scale_t* scale)
+{
+    int step = params->step;
+    int width = params->width * step - 1, height = params->height * step - 1;
+
+    eller_t self;
+    self.columns = (width + step - 1) / step;
+    self.rows = (height + step - 1) / step;
+    self.left = 0;
+    rng_seed(&self.rng, params->seed, 0);
+
+    size_t columns = self.columns;
+    self.sets = malloc(columns * sizeof(int));
+    self.parents = malloc(2 * columns * sizeof(int));
+    self.last = malloc(2 * columns * sizeof(int));
+    self.opened = malloc(2 * columns);
+    self.used = malloc(2 * columns);
+    self.right = malloc(columns);
+    self.down = malloc(columns);
+
+    map_t band = {0};
+    bool ok = self.sets && self.parents && self.last && self.opened && self.used && self.right && self.down;
+
+    if(!ok)
+        fprintf(stderr, "eller_generate() Failed to allocate a row of %d steps!\n", self.columns);
+    else
+        ok = map_init(&band, width, step);
+
+    // `image_close()` frees the image even if `image_open()` failed.
+    image_t image;
+    bool opened = false;
+
+    if(ok)
+    {
+        // The first row starts with every step in a set of its own.
+        for(int x = 0; x < self.columns; x++)
+            self.sets[x] = x;
+
+        for(int i = 0; i < 2 * self.columns; i++)
+            self.parents[i] = i;
+
+        opened = true;
+        ok = image_open_maze(&image, path, format, depth, params, scale);
+    }
+
+    // Top of the frame, which is all wall like the band's own frame rows.
+    if(ok) ok = image_write_row(&image, map_row(&band, -1));
+
+    for(int y = 0; ok && y < self.rows; y++)
+    {
+        eller_row(&self, y);
+        eller_draw(&self, &band, step);
+
+        // The maze ends one cell after its last steps.
+        int rows = (y == self.rows - 1) ? height - y * step : step;
+
+        for(int k = 0; ok && k < rows; k++)
+            ok = image_write_row(&image, map_row(&band, k));
+    }
+
+    if(ok) ok = image_write_row(&image, map_row(&band, -1));
+
+    if(opened && !image_close(&image))
+    {
+        if(ok) fprintf(stderr, "eller_generate() Failed to write '%s'!\n", path);
+        ok = false;
+    }
+
+    if(band.bits != NULL) map_free(&band);
+
+    free(self.sets);
+    free(self.parents);
+    free(self.last);
+    free(self.opened);
+    free(self.used);
+    free(self.right);
+    free(self.down);
+    return ok;
+}
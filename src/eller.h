@@ -0,0 +1,52 @@
+
+/** eller.h, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * Generates mazes with Eller's algorithm, one row of steps at a time.
+ *
+ * Only the current row is kept: the set each of its steps belongs to,
+ * where two steps are in the same set if the rows above already join
+ * them. Neighbours in different sets may be joined at random, and every
+ * set opens at least one passage down, so the finished maze is a perfect
+ * maze. Each row is streamed to the output file as soon as it is done, so
+ * memory only grows with the width of the maze, never with its height.
+ */
+
+#ifndef MAZEGEN_ELLER_H
+#define MAZEGEN_ELLER_H
+
+#include "image.h"
+#include "maze.h"
+
+#include <stdbool.h>
+
+/** \brief Generates a maze with the size, step and seed in `params` and
+ *  streams it to the image at `path`, scaled by `scale` unless it is
+ *  NULL. The other options of `params` have no effect.
+ *
+ * \param params const maze_params_t*
+ * \param path const char*
+ * \param format int
+ * \param depth int
+ * \param scale const image_scale_t*
+ * \return bool
+ */
+bool eller_generate(const maze_params_t* params, const char* path, int format, int depth, const image_scale_t* scale);
+
+#endif // MAZEGEN_ELLER_H
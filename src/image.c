@@ -0,0 +1,819 @@
+
+/** image.c, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "image.h"
+#include "tree.h"
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#define PNG_BLOCK_SIZE 65535
+
+static void put_u16(unsigned char* p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put_u32(unsigned char* p, uint32_t v)
+{
+    put_u16(p, v & 0xFFFF);
+    put_u16(p + 2, v >> 16);
+}
+
+static void put_u32_be(unsigned char* p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static bool has_extension(const char* path, const char* ext)
+{
+    size_t length = strlen(path), ext_length = strlen(ext);
+    if(length < ext_length) return false;
+
+    path += length - ext_length;
+    for(size_t i = 0; i < ext_length; i++)
+    {
+        if((path[i] | 0x20) != ext[i]) return false;
+    }
+
+    return true;
+}
+
+int image_format_from_path(const char* path)
+{
+    if(has_extension(path, ".png"))
+        return IMAGE_PNG;
+
+    if(has_extension(path, ".raw"))
+        return IMAGE_RAW;
+
+    if(has_extension(path, ".mzt"))
+        return IMAGE_TREE;
+
+    return IMAGE_BMP;
+}
+
+bool image_supports(int format, int depth)
+{
+    if(format == IMAGE_BMP)
+        return depth == 1 || depth == 8 || depth == 24;
+
+    if(format == IMAGE_PNG || format == IMAGE_RAW)
+        return depth == 1 || depth == 8;
+
+    if(format == IMAGE_TREE)
+        return depth == 1;
+
+    return false;
+}
+
+// B M P //
+// ===== //
+
+/** \brief Fills `header` with the headers of a `depth`-bit BMP file of
+ *  `width` by `height` pixels, and returns their size, which is where the
+ *  pixels start. Returns 0 if the file would be too big for BMP.
+ */
+static uint32_t bmp_header(unsigned char header[62], int width, int height, int depth, size_t row_size)
+{
+    uint32_t palette_size = (depth == 24) ? 0 : 8;
+    uint32_t offset = 54 + palette_size;
+    uint64_t file_size = offset + (uint64_t)row_size * height;
+    if(file_size > UINT32_MAX)
+        return 0;
+
+    // File header and BITMAPINFOHEADER. A negative height stores the
+    // rows top to bottom, so they can be written in the order they come.
+    memset(header, 0, 62);
+    header[0] = 'B';
+    header[1] = 'M';
+    put_u32(header + 2, file_size);
+    put_u32(header + 10, offset);
+    put_u32(header + 14, 40);
+    put_u32(header + 18, width);
+    put_u32(header + 22, -(int32_t)height);
+    put_u16(header + 26, 1);
+    put_u16(header + 28, depth);
+    put_u32(header + 34, row_size * height);
+    put_u32(header + 38, 2835); // 72 DPI.
+    put_u32(header + 42, 2835);
+
+    // Palette: index 0 is black, index 1 is white.
+    if(palette_size)
+    {
+        put_u32(header + 46, 2);
+        put_u32(header + 58, 0xFFFFFF);
+    }
+
+    return offset;
+}
+
+static bool bmp_write_header(image_t* self)
+{
+    unsigned char header[62];
+    uint32_t offset = bmp_header(header, self->width, self->height, self->depth, self->row_size);
+    if(offset == 0)
+    {
+        fprintf(stderr, "image_open() Image is too big for a .bmp file, use .png instead!\n");
+        return false;
+    }
+
+    return fwrite(header, offset, 1, self->file) == 1;
+}
+
+// P N G //
+// ===== //
+
+static uint32_t png_crc(image_t* self, uint32_t crc, const unsigned char* data, size_t length)
+{
+    for(size_t i = 0; i < length; i++)
+        crc = self->crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+
+    return crc;
+}
+
+static uint32_t png_adler(uint32_t adler, const unsigned char* data, size_t length)
+{
+    uint32_t a = adler & 0xFFFF, b = adler >> 16;
+    while(length)
+    {
+        // 5552 is the most bytes that can be summed before `b` overflows.
+        size_t n = length < 5552 ? length : 5552;
+        length -= n;
+
+        while(n--)
+        {
+            a += *data++;
+            b += a;
+        }
+
+        a %= 65521;
+        b %= 65521;
+    }
+
+    return (b << 16) | a;
+}
+
+/** \brief Writes a chunk whose data is the concatenation of `count` parts.
+ */
+static bool png_write_chunk(image_t* self, const char* type, const unsigned char** parts, const size_t* lengths, int count)
+{
+    uint32_t length = 0;
+    for(int i = 0; i < count; i++)
+        length += lengths[i];
+
+    unsigned char buffer[8];
+    put_u32_be(buffer, length);
+    memcpy(buffer + 4, type, 4);
+
+    uint32_t crc = png_crc(self, 0xFFFFFFFF, buffer + 4, 4);
+    bool ok = fwrite(buffer, 8, 1, self->file) == 1;
+
+    for(int i = 0; ok && i < count; i++)
+    {
+        if(lengths[i] == 0) continue;
+
+        crc = png_crc(self, crc, parts[i], lengths[i]);
+        ok = fwrite(parts[i], lengths[i], 1, self->file) == 1;
+    }
+
+    put_u32_be(buffer, crc ^ 0xFFFFFFFF);
+    return ok && fwrite(buffer, 4, 1, self->file) == 1;
+}
+
+static bool png_write_header(image_t* self)
+{
+    for(uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t c = i;
+        for(int k = 0; k < 8; k++)
+            c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+
+        self->crc_table[i] = c;
+    }
+
+    static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if(fwrite(signature, 8, 1, self->file) != 1) return false;
+
+    // Greyscale, no interlacing.
+    unsigned char ihdr[13] = {0};
+    put_u32_be(ihdr, self->width);
+    put_u32_be(ihdr + 4, self->height);
+    ihdr[8] = self->depth;
+
+    const unsigned char* parts[] = {ihdr};
+    const size_t lengths[] = {sizeof(ihdr)};
+    return png_write_chunk(self, "IHDR", parts, lengths, 1);
+}
+
+/** \brief Writes the pending data as one stored (uncompressed) deflate
+ *  block in its own IDAT chunk. The zlib header goes in front of the
+ *  first block, and the checksum after the final one.
+ */
+static bool png_flush(image_t* self, bool final)
+{
+    unsigned char zlib_header[2] = {0x78, 0x01};
+    unsigned char block_header[5] = {final};
+    unsigned char adler[4];
+
+    put_u16(block_header + 1, self->block_length);
+    put_u16(block_header + 3, ~self->block_length);
+    put_u32_be(adler, self->adler);
+
+    const unsigned char* parts[] = {zlib_header, block_header, self->block, adler};
+    const size_t lengths[] = {self->started ? 0 : 2, 5, self->block_length, final ? 4 : 0};
+
+    self->started = true;
+    self->block_length = 0;
+
+    return png_write_chunk(self, "IDAT", parts, lengths, 4);
+}
+
+static bool png_append(image_t* self, const unsigned char* data, size_t length)
+{
+    self->adler = png_adler(self->adler, data, length);
+
+    while(length)
+    {
+        size_t n = PNG_BLOCK_SIZE - self->block_length;
+        if(n > length) n = length;
+
+        memcpy(self->block + self->block_length, data, n);
+        self->block_length += n;
+        data += n;
+        length -= n;
+
+        if(self->block_length == PNG_BLOCK_SIZE && !png_flush(self, false))
+            return false;
+    }
+
+    return true;
+}
+
+// T R E E //
+// ========= //
+
+/// Steps across a maze of `cells` cells, with `step` cells to a step.
+static int tree_steps(int cells, int step)
+{
+    return (cells + step - 1) / step;
+}
+
+static bool tree_write_header(image_t* self)
+{
+    int columns = tree_steps(self->width - 2, self->step);
+    int rows = tree_steps(self->height - 2, self->step);
+
+    unsigned char header[TREE_HEADER_SIZE] = {0};
+    memcpy(header, TREE_MAGIC, 4);
+    put_u16(header + 4, TREE_VERSION);
+    put_u16(header + 6, TREE_HEADER_SIZE);
+    put_u32(header + 8, columns);
+    put_u32(header + 12, rows);
+    put_u32(header + 16, self->row_size);
+    put_u32(header + 20, self->step);
+    put_u32(header + 24, self->mode);
+    put_u32(header + 32, (uint64_t)self->seed & 0xFFFFFFFF);
+    put_u32(header + 36, (uint64_t)self->seed >> 32);
+
+    return fwrite(header, sizeof(header), 1, self->file) == 1;
+}
+
+static bool tree_flush(image_t* self)
+{
+    self->pending = -1;
+    return fwrite(self->row, self->row_size, 1, self->file) == 1;
+}
+
+/** \brief Takes the pixel row just written. The first row through a row
+ *  of steps tells which steps open right, and the row after it which open
+ *  down, which finishes the row of steps.
+ */
+static bool tree_write_row(image_t* self, const unsigned char* bits)
+{
+    int y = self->rows - 2;
+    int step = self->step;
+    int columns = tree_steps(self->width - 2, step);
+
+    // The frame has no passages, but the last row of steps ends at it.
+    if(y < 0 || y >= self->height - 2)
+        return self->pending < 0 || tree_flush(self);
+
+    bool ok = true;
+    if(self->pending >= 0 && y == self->pending * step + 1)
+    {
+        for(int x = 0; x < columns; x++)
+        {
+            int cell = x * step + 1;
+            if((bits[cell >> 3] >> (7 - (cell & 7))) & 1)
+                self->row[x >> 2] |= TREE_SOUTH << ((x & 3) * 2);
+        }
+
+        ok = tree_flush(self);
+    }
+
+    if(y % step == 0)
+    {
+        self->pending = y / step;
+        memset(self->row, 0, self->row_size);
+
+        for(int x = 0; x + 1 < columns; x++)
+        {
+            int cell = x * step + 2;
+            if((bits[cell >> 3] >> (7 - (cell & 7))) & 1)
+                self->row[x >> 2] |= TREE_EAST << ((x & 3) * 2);
+        }
+    }
+
+    return ok;
+}
+
+// S C A L E //
+// ========= //
+
+/// Largest number of pixels across a cell can become.
+#define SCALE_MAX 1024
+
+/// Pixels across or down line `cell` of `cells` becomes, frame included.
+/// Only lines through steps are floors.
+static int scale_thickness(const image_t* self, int cell, int cells)
+{
+    bool floor = cell > 0 && cell < cells - 1 && (cell - 1) % self->step == 0;
+    return floor ? self->scale.floor : self->scale.wall;
+}
+
+/// Pixels across `cells` cells, frame included.
+static uint64_t scale_size(const image_t* self, int cells)
+{
+    uint64_t steps = tree_steps(cells - 2, self->step);
+    return steps * self->scale.floor + (cells - steps) * self->scale.wall;
+}
+
+/** \brief Sets bits `x` to `x + length` of `bits`.
+ */
+static void scale_fill(unsigned char* bits, size_t x, size_t length)
+{
+    for(; length && (x & 7); x++, length--)
+        bits[x >> 3] |= 0x80 >> (x & 7);
+
+    memset(bits + (x >> 3), 0xFF, length >> 3);
+    x += length & ~(size_t)7;
+
+    for(length &= 7; length; x++, length--)
+        bits[x >> 3] |= 0x80 >> (x & 7);
+}
+
+/** \brief Allocates the widened row and, if every cell becomes the same
+ *  `n` pixels across, the table of the `n` bytes each byte of a row
+ *  widens to. Entries are at least 8 bytes apart, so narrow ones can be
+ *  copied 8 bytes at a time. Otherwise it notes how wide each cell is.
+ */
+static bool scale_start(image_t* self)
+{
+    // Widening whole bytes writes up to 8 bytes past the end of the row.
+    size_t size = ((size_t)self->width + 7) / 8 + SCALE_MAX + 8;
+    self->scaled = calloc(size, 1);
+    if(self->scaled == NULL) return false;
+
+    if(self->scale.floor != self->scale.wall)
+    {
+        self->widths = malloc((size_t)self->cells_width * sizeof(uint16_t));
+        if(self->widths == NULL) return false;
+
+        for(int cell = 0; cell < self->cells_width; cell++)
+            self->widths[cell] = scale_thickness(self, cell, self->cells_width);
+
+        return true;
+    }
+
+    int n = self->scale.floor;
+    self->expand_stride = n < 8 ? 8 : n;
+    self->expand = calloc(256, self->expand_stride);
+    if(self->expand == NULL) return false;
+
+    for(int byte = 0; byte < 256; byte++)
+    {
+        for(int bit = 0; bit < 8; bit++)
+        {
+            if((byte >> (7 - bit)) & 1)
+                scale_fill(self->expand + byte * self->expand_stride, (size_t)bit * n, n);
+        }
+    }
+
+    return true;
+}
+
+/** \brief Widens `bits` into `self->scaled`.
+ */
+static void scale_row(image_t* self, const unsigned char* bits)
+{
+    size_t bytes = ((size_t)self->cells_width + 7) / 8;
+    unsigned char* out = self->scaled;
+
+    if(self->expand != NULL)
+    {
+        int n = self->scale.floor;
+        const unsigned char* expand = self->expand;
+        size_t stride = self->expand_stride;
+
+        // A fixed size copy is a single store; the next one overwrites
+        // whatever went past the `n` bytes that are wanted.
+        if(n <= 8)
+        {
+            for(size_t i = 0; i < bytes; i++, out += n)
+                memcpy(out, expand + bits[i] * stride, 8);
+        }
+        else
+        {
+            for(size_t i = 0; i < bytes; i++, out += n)
+                memcpy(out, expand + bits[i] * stride, n);
+        }
+
+        return;
+    }
+
+    // Otherwise shift each cell's pixels into `pending`, 32 at most at a
+    // time, and store them 32 at a time. Cells alternate between walls
+    // and floors too often for runs of them to be worth finding.
+    const uint16_t* widths = self->widths;
+    uint64_t pending = 0;
+    int count = 0;
+
+    for(int cell = 0; cell < self->cells_width; cell++)
+    {
+        uint64_t set = -(uint64_t)((bits[cell >> 3] >> (7 - (cell & 7))) & 1);
+        for(int width = widths[cell]; width > 0; width -= 32)
+        {
+            int n = width < 32 ? width : 32;
+            pending = (pending << n) | (set >> (64 - n));
+            count += n;
+
+            if(count >= 32)
+            {
+                count -= 32;
+                put_u32_be(out, pending >> count);
+                out += 4;
+            }
+        }
+    }
+
+    if(count > 0)
+    {
+        unsigned char last[4];
+        put_u32_be(last, pending << (32 - count));
+        memcpy(out, last, (count + 7) / 8);
+    }
+}
+
+// I M A G E //
+// ========= //
+
+/** \brief Opens an image of any format. `params` is only read for
+ *  IMAGE_TREE and scaled images, and `scale` may be NULL.
+ */
+static bool image_start(image_t* self, const char* path, int format, int depth, int width, int height, const maze_params_t* params, const image_scale_t* scale)
+{
+    self->file = NULL;
+    self->row = NULL;
+    self->block = NULL;
+    self->scaled = NULL;
+    self->expand = NULL;
+    self->widths = NULL;
+    self->format = format;
+    self->depth = depth;
+    self->width = self->cells_width = width;
+    self->height = self->cells_height = height;
+    self->rows = 0;
+    self->block_length = 0;
+    self->adler = 1;
+    self->started = false;
+    self->pending = -1;
+
+    if(format == IMAGE_TREE && params == NULL)
+    {
+        fprintf(stderr, "image_open() .mzt files can only be saved from a maze!\n");
+        return false;
+    }
+
+    if(format == IMAGE_TREE)
+    {
+        self->step = params->step;
+        self->mode = params->mode;
+        self->seed = params->seed;
+    }
+
+    if(!image_supports(format, depth))
+    {
+        fprintf(stderr, "image_open() %d-bit images can't be saved in this format!\n", depth);
+        return false;
+    }
+
+    if(scale != NULL && (scale->floor != 1 || scale->wall != 1))
+    {
+        if(scale->floor < 1 || scale->wall < 1 || scale->floor > SCALE_MAX || scale->wall > SCALE_MAX)
+        {
+            fprintf(stderr, "image_open() Cells can only be scaled to 1-%d pixels!\n", SCALE_MAX);
+            return false;
+        }
+
+        if(params == NULL || format == IMAGE_TREE)
+        {
+            fprintf(stderr, "image_open() Only images of a maze can be scaled!\n");
+            return false;
+        }
+
+        self->scale = *scale;
+        self->step = params->step;
+
+        uint64_t scaled_width = scale_size(self, width), scaled_height = scale_size(self, height);
+        if(scaled_width > INT32_MAX || scaled_height > INT32_MAX)
+        {
+            fprintf(stderr, "image_open() Image is too big once scaled!\n");
+            return false;
+        }
+
+        self->width = scaled_width;
+        self->height = scaled_height;
+        width = self->width;
+
+        if(!scale_start(self))
+        {
+            fprintf(stderr, "image_open() Failed to allocate scaled row!\n");
+            return false;
+        }
+    }
+
+    if(format == IMAGE_BMP)
+    {
+        self->row_size = (((size_t)width * depth + 31) / 32) * 4;
+    }
+    else if(format == IMAGE_RAW)
+    {
+        self->row_size = ((size_t)width * depth + 7) / 8;
+    }
+    else if(format == IMAGE_TREE)
+    {
+        self->row_size = ((size_t)tree_steps(width - 2, self->step) * 2 + 7) / 8;
+    }
+    else
+    {
+        // Each PNG row starts with its filter type.
+        self->row_size = 1 + ((size_t)width * depth + 7) / 8;
+        self->block = malloc(PNG_BLOCK_SIZE);
+    }
+
+    self->row = calloc(self->row_size, 1);
+    if(self->row == NULL || (format == IMAGE_PNG && self->block == NULL))
+    {
+        fprintf(stderr, "image_open() Failed to allocate row buffer!\n");
+        return false;
+    }
+
+    self->file = fopen(path, "wb");
+    if(self->file == NULL)
+    {
+        fprintf(stderr, "image_open() Failed to open '%s'!\n", path);
+        return false;
+    }
+
+    setvbuf(self->file, NULL, _IOFBF, 1 << 20);
+
+    bool ok = true;
+    if(format == IMAGE_BMP)
+        ok = bmp_write_header(self);
+    else if(format == IMAGE_PNG)
+        ok = png_write_header(self);
+    else if(format == IMAGE_TREE)
+        ok = tree_write_header(self);
+
+    if(!ok) fprintf(stderr, "image_open() Failed to write '%s'!\n", path);
+
+    return ok;
+}
+
+bool image_open(image_t* self, const char* path, int format, int depth, int width, int height)
+{
+    return image_start(self, path, format, depth, width, height, NULL, NULL);
+}
+
+bool image_open_maze(image_t* self, const char* path, int format, int depth, const maze_params_t* params, const image_scale_t* scale)
+{
+    int width = params->width * params->step - 1, height = params->height * params->step - 1;
+    return image_start(self, path, format, depth, width + 2, height + 2, params, scale);
+}
+
+bool image_write_row(image_t* self, const unsigned char* bits)
+{
+    if(self->rows == self->cells_height) return false;
+    int y = self->rows++;
+
+    if(self->format == IMAGE_TREE)
+        return tree_write_row(self, bits);
+
+    // A scaled row is widened once, then written once for each pixel
+    // row it becomes.
+    int repeat = 1;
+    if(self->scaled != NULL)
+    {
+        scale_row(self, bits);
+        bits = self->scaled;
+        repeat = scale_thickness(self, y, self->cells_height);
+    }
+
+    unsigned char* out = self->row + (self->format == IMAGE_PNG);
+    int width = self->width;
+
+    if(self->depth == 1)
+    {
+        memcpy(out, bits, ((size_t)width + 7) / 8);
+    }
+    else if(self->depth == 8)
+    {
+        // BMP stores palette indices, PNG and raw files store grey levels.
+        unsigned char white = (self->format == IMAGE_BMP) ? 0x01 : 0xFF;
+        for(int x = 0; x < width; x++)
+            out[x] = (bits[x >> 3] >> (7 - (x & 7))) & 1 ? white : 0x00;
+    }
+    else
+    {
+        for(int x = 0; x < width; x++)
+            memset(out + (size_t)x * 3, (bits[x >> 3] >> (7 - (x & 7))) & 1 ? 0xFF : 0x00, 3);
+    }
+
+    bool ok = true;
+    for(; ok && repeat > 0; repeat--)
+    {
+        if(self->format == IMAGE_PNG)
+            ok = png_append(self, self->row, self->row_size);
+        else
+            ok = fwrite(self->row, self->row_size, 1, self->file) == 1;
+    }
+
+    return ok;
+}
+
+bool image_close(image_t* self)
+{
+    bool ok = self->file != NULL && self->rows == self->cells_height;
+
+    if(ok && self->format == IMAGE_PNG)
+    {
+        const unsigned char* parts[] = {NULL};
+        const size_t lengths[] = {0};
+        ok = png_flush(self, true) && png_write_chunk(self, "IEND", parts, lengths, 1);
+    }
+
+    if(self->file != NULL && fclose(self->file) != 0)
+        ok = false;
+
+    free(self->row);
+    free(self->block);
+    free(self->scaled);
+    free(self->expand);
+    free(self->widths);
+    self->file = NULL;
+    self->row = NULL;
+    self->block = NULL;
+    self->scaled = NULL;
+    self->expand = NULL;
+    self->widths = NULL;
+
+    return ok;
+}
+
+/** \brief Writes every row of `map` to `image`, if `ok` says it opened,
+ *  and closes it.
+ */
+static bool image_write_map(image_t* image, bool ok, const map_t* map, const char* path)
+{
+    for(int y = -1; ok && y <= map->height; y++)
+        ok = image_write_row(image, map_row(map, y));
+
+    if(!image_close(image))
+    {
+        if(ok) fprintf(stderr, "image_save() Failed to write '%s'!\n", path);
+        ok = false;
+    }
+
+    return ok;
+}
+
+bool image_save(const map_t* map, const char* path, int format, int depth)
+{
+    image_t image;
+    bool ok = image_open(&image, path, format, depth, map->width + 2, map->height + 2);
+    return image_write_map(&image, ok, map, path);
+}
+
+bool image_save_maze(const maze_t* maze, const char* path, int format, int depth, const image_scale_t* scale)
+{
+    image_t image;
+    bool ok = image_open_maze(&image, path, format, depth, &maze->params, scale);
+    return image_write_map(&image, ok, &maze->map, path);
+}
+
+// M A P P E D //
+// =========== //
+
+bool image_map(image_mapping_t* self, const char* path, int format, int depth, int width, int height)
+{
+    self->data = NULL;
+    self->size = 0;
+    self->pixels = NULL;
+    self->pixels_size = 0;
+
+    size_t stride = (((size_t)width + 31) / 32) * 4;
+    size_t header_size = 0;
+    unsigned char header[62];
+
+    if(depth != 1 || (format != IMAGE_BMP && format != IMAGE_RAW))
+    {
+        fprintf(stderr, "image_map() Only 1-bit .bmp and .raw files can be written in place!\n");
+        return false;
+    }
+
+    if(format == IMAGE_RAW && ((size_t)width + 7) / 8 != stride)
+    {
+        fprintf(stderr, "image_map() Rows of a .raw file are only laid out like a map if the width with frame is a multiple of 32, not %d!\n", width);
+        return false;
+    }
+
+    if(format == IMAGE_BMP && (header_size = bmp_header(header, width, height, depth, stride)) == 0)
+    {
+        fprintf(stderr, "image_map() Image is too big for a .bmp file!\n");
+        return false;
+    }
+
+    size_t size = header_size + stride * height;
+
+    int file = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if(file < 0)
+    {
+        fprintf(stderr, "image_map() Failed to create '%s'!\n", path);
+        return false;
+    }
+
+    // Not every file system can reserve space; those fall back to a
+    // sparse file.
+    int error = posix_fallocate(file, 0, size);
+    if(error == EINVAL || error == EOPNOTSUPP)
+        error = ftruncate(file, size) == 0 ? 0 : errno;
+
+    void* data = MAP_FAILED;
+    if(error == 0)
+        data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+
+    close(file);
+
+    if(error != 0 || data == MAP_FAILED)
+    {
+        fprintf(stderr, "image_map() Failed to make room for %zu bytes in '%s'!\n", size, path);
+        return false;
+    }
+
+    self->data = data;
+    self->size = size;
+    self->pixels = (unsigned char*)data + header_size;
+    self->pixels_size = stride * height;
+
+    memcpy(data, header, header_size);
+    return true;
+}
+
+bool image_unmap(image_mapping_t* self)
+{
+    bool ok = self->data == NULL || munmap(self->data, self->size) == 0;
+
+    self->data = NULL;
+    self->pixels = NULL;
+    return ok;
+}
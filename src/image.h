@@ -0,0 +1,229 @@
+
+/** image.h, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * Writes black and white images without any third party library.
+ *
+ * Images are streamed one row at a time, top to bottom, from rows laid
+ * out like a map row: one bit per pixel, most significant bit first, 1 for
+ * white. Only a single converted row (and, for PNG, one 64 KiB deflate
+ * block) is held in memory, whatever the size of the image.
+ *
+ * The same writer saves mazes in the compact .mzt format of tree.h,
+ * packing each row of steps as the pixel rows through it come in.
+ *
+ * Images of a maze can be scaled as they are streamed: each row is
+ * widened once, through a table when every cell becomes the same number
+ * of pixels, and the widened row written as many times as it is tall.
+ */
+
+#ifndef MAZEGEN_IMAGE_H
+#define MAZEGEN_IMAGE_H
+
+#include "map.h"
+#include "maze.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+enum {
+    IMAGE_BMP = 1,
+    IMAGE_PNG = 2,
+
+    /// Rows packed one after another, with no header or padding.
+    IMAGE_RAW = 3,
+
+    /// The passages of a maze, 2 bits per step, as described in tree.h.
+    /// Only written by `image_open_maze()`, which knows the step.
+    IMAGE_TREE = 4,
+};
+
+/// The pixels across and down that each cell of a maze becomes. A cell
+/// in both a column and a row of steps is `floor` by `floor` pixels, one
+/// in neither is `wall` by `wall`, and the rest are a mix of the two. The
+/// frame is made of walls.
+typedef struct image_scale_s {
+    int floor, wall;
+} image_scale_t;
+
+typedef struct image_s {
+    FILE* file;
+    int format, depth;
+    int width, height, rows;
+
+    /// Width and height of the rows passed in, which differ from `width`
+    /// and `height` only when the image is scaled.
+    int cells_width, cells_height;
+
+    /// One converted row, padded as the format requires.
+    unsigned char* row;
+    size_t row_size;
+
+    /// The row passed in, widened, and when the scale is even, the bytes
+    /// each byte of it widens to, or else the pixels across each cell.
+    /// NULL if the image is not scaled.
+    image_scale_t scale;
+    unsigned char* scaled;
+    unsigned char* expand;
+    size_t expand_stride;
+    uint16_t* widths;
+
+    /// Pending deflate block, PNG only.
+    unsigned char* block;
+    size_t block_length;
+    uint32_t adler;
+    bool started;
+
+    uint32_t crc_table[256];
+
+    /// Step, mode and seed of the maze, and the row of steps whose
+    /// passages down are still to come, or -1. Only the step is used by
+    /// scaled images, the rest are IMAGE_TREE only.
+    int step, mode;
+    long seed;
+    int pending;
+} image_t;
+
+/// A file created at its full size and mapped into memory, whose
+/// pixels can be written in place. See `image_map()`.
+typedef struct image_mapping_s {
+    /// The whole file.
+    void* data;
+    size_t size;
+
+    /// The pixels, laid out like the rows of a map, frame included.
+    unsigned char* pixels;
+    size_t pixels_size;
+} image_mapping_t;
+
+/** \brief Returns IMAGE_PNG if `path` ends in ".png", IMAGE_RAW if it
+ *  ends in ".raw", IMAGE_TREE if it ends in ".mzt", or IMAGE_BMP
+ *  otherwise.
+ *
+ * \param path const char*
+ * \return int
+ */
+int image_format_from_path(const char* path);
+
+/** \brief Returns true if `format` can be written with `depth` bits per
+ *  pixel. BMP supports 1, 8 and 24 bits, PNG and raw files support 1
+ *  and 8 bits, and .mzt files only 1.
+ *
+ * \param format int
+ * \param depth int
+ * \return bool
+ */
+bool image_supports(int format, int depth);
+
+/** \brief Creates the file at `path` and writes the image header. Call
+ *  `image_close()` afterwards, even if this fails.
+ *
+ * \param self image_t*
+ * \param path const char*
+ * \param format int
+ * \param depth int
+ * \param width int
+ * \param height int
+ * \return bool
+ */
+bool image_open(image_t* self, const char* path, int format, int depth, int width, int height);
+
+/** \brief `image_open()` for the whole of a maze with `params`, frame
+ *  included. Unlike `image_open()`, it can write any format, and scale
+ *  the maze by `scale` unless it is NULL. Rows are still passed in one
+ *  bit per cell. .mzt files can't be scaled.
+ *
+ * \param self image_t*
+ * \param path const char*
+ * \param format int
+ * \param depth int
+ * \param params const maze_params_t*
+ * \param scale const image_scale_t*
+ * \return bool
+ */
+bool image_open_maze(image_t* self, const char* path, int format, int depth, const maze_params_t* params, const image_scale_t* scale);
+
+/** \brief Writes the next row of the image. `bits` holds `cells_width`
+ *  pixels, which is `width` unless the image is scaled.
+ *
+ * \param self image_t*
+ * \param bits const unsigned char*
+ * \return bool
+ */
+bool image_write_row(image_t* self, const unsigned char* bits);
+
+/** \brief Finishes the file and frees the writer. Returns false if any
+ *  write failed or fewer than `cells_height` rows were written.
+ *
+ * \param self image_t*
+ * \return bool
+ */
+bool image_close(image_t* self);
+
+/** \brief Saves `map`, frame included, to `path`. Floors are white and
+ *  walls are black.
+ *
+ * \param map const map_t*
+ * \param path const char*
+ * \param format int
+ * \param depth int
+ * \return bool
+ */
+bool image_save(const map_t* map, const char* path, int format, int depth);
+
+/** \brief `image_save()` for the map of `maze`, which can also be saved
+ *  as IMAGE_TREE, or scaled by `scale` unless it is NULL.
+ *
+ * \param maze const maze_t*
+ * \param path const char*
+ * \param format int
+ * \param depth int
+ * \param scale const image_scale_t*
+ * \return bool
+ */
+bool image_save_maze(const maze_t* maze, const char* path, int format, int depth, const image_scale_t* scale);
+
+/** \brief Creates the file at `path` at its full size, maps it into
+ *  memory, and writes its header, so the pixels can be filled in place
+ *  by a map laid out with `map_init_buffer()` over `pixels`. Only 1-bit
+ *  images are laid out like a map: BMP files, and raw files whose rows
+ *  happen to need no padding. The pages of the file are reserved up
+ *  front, so a full disk is reported here rather than while writing.
+ *  Call `image_unmap()` afterwards, even if this fails.
+ *
+ * \param self image_mapping_t*
+ * \param path const char*
+ * \param format int
+ * \param depth int
+ * \param width int
+ * \param height int
+ * \return bool
+ */
+bool image_map(image_mapping_t* self, const char* path, int format, int depth, int width, int height);
+
+/** \brief Unmaps a file from `image_map()`. Its pixels are written back
+ *  by the kernel as it sees fit, so this doesn't wait for the disk.
+ *
+ * \param self image_mapping_t*
+ * \return bool
+ */
+bool image_unmap(image_mapping_t* self);
+
+#endif // MAZEGEN_IMAGE_H
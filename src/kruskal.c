@@ -0,0 +1,521 @@
+
+/** kruskal.c, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "kruskal.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+// W A L L S //
+// ========= //
+
+/** \brief Returns the weight of `wall`: the top half hashed from the
+ *  seed, and the bottom half the number of the wall, so no two walls ever
+ *  weigh the same.
+ */
+static uint64_t kruskal_weight(const kruskal_t* self, uint32_t wall)
+{
+    return (rng_hash(self->seed, wall, MODE_KRUSKAL) & 0xffffffff00000000) | wall;
+}
+
+/** \brief Returns the steps on either side of `wall`.
+ */
+static void kruskal_ends(const kruskal_t* self, uint32_t wall, uint32_t* a, uint32_t* b)
+{
+    *a = wall >> 1;
+    *b = *a + ((wall & 1) ? (uint32_t)self->columns : 1);
+}
+
+/** \brief Knocks down `wall`. With `shared`, other threads may be
+ *  knocking down walls of the same map.
+ */
+static void kruskal_carve(maze_t* maze, uint32_t wall, bool shared)
+{
+    const kruskal_t* self = maze->kruskal;
+    int step = maze->params.step;
+    uint32_t a = wall >> 1;
+
+    int x = (a % self->columns) * step;
+    int y = (a / self->columns) * step;
+    int dx = (wall & 1) ? 0 : 1;
+    int dy = (wall & 1) ? 1 : 0;
+
+    for(int i = 1; i < step; i++)
+    {
+        if(shared)
+            map_claim(&maze->map, x + dx * i, y + dy * i);
+        else
+            maze_carve(maze, x + dx * i, y + dy * i);
+    }
+}
+
+/** \brief Sorts every wall into `self->order`. The weights are uniform,
+ *  so the walls are dealt into buckets by their top bits, with a few walls
+ *  to each bucket, and only the buckets need sorting.
+ */
+static bool kruskal_sort(kruskal_t* self)
+{
+    int bits = 1;
+    while(bits < 31 && ((size_t)1 << bits) < self->walls / 4)
+        bits++;
+
+    size_t buckets = (size_t)1 << bits;
+
+    self->order = malloc(self->walls * sizeof(uint32_t));
+    size_t* ends = calloc(buckets + 1, sizeof(size_t));
+    if(self->order == NULL || ends == NULL)
+    {
+        fprintf(stderr, "kruskal_sort() Failed to allocate wall list!\n");
+        free(self->order);
+        free(ends);
+        self->order = NULL;
+        return false;
+    }
+
+    // Count the walls of each bucket, then deal them out. //
+    for(int pass = 0; pass < 2; pass++)
+    {
+        for(int y = 0; y < self->rows; y++)
+        {
+            for(int x = 0; x < self->columns; x++)
+            {
+                uint32_t step = (uint32_t)y * self->columns + x;
+
+                for(int down = 0; down < 2; down++)
+                {
+                    if(down ? y == self->rows - 1 : x == self->columns - 1)
+                        continue;
+
+                    uint32_t wall = step * 2 + down;
+                    size_t bucket = kruskal_weight(self, wall) >> (64 - bits);
+
+                    if(pass == 0)
+                        ends[bucket + 1]++;
+                    else
+                        self->order[ends[bucket]++] = wall;
+                }
+            }
+        }
+
+        if(pass == 0)
+        {
+            for(size_t i = 1; i <= buckets; i++)
+                ends[i] += ends[i - 1];
+        }
+    }
+
+    // Each bucket now ends where the next one starts. //
+    for(size_t bucket = 0, start = 0; bucket < buckets; start = ends[bucket++])
+    {
+        for(size_t i = start + 1; i < ends[bucket]; i++)
+        {
+            uint32_t wall = self->order[i];
+            uint64_t weight = kruskal_weight(self, wall);
+
+            size_t j = i;
+            for(; j > start && weight < kruskal_weight(self, self->order[j - 1]); j--)
+                self->order[j] = self->order[j - 1];
+
+            self->order[j] = wall;
+        }
+    }
+
+    free(ends);
+    return true;
+}
+
+// U N I O N - F I N D //
+// =================== //
+
+static uint32_t kruskal_find(uint32_t* parents, uint32_t step)
+{
+    while(parents[step] != step)
+    {
+        parents[step] = parents[parents[step]];
+        step = parents[step];
+    }
+
+    return step;
+}
+
+/** \brief `kruskal_find()` for trees which other threads may be joining.
+ *  Halving the path is only a shortcut, so a failed swap is let go.
+ */
+static uint32_t kruskal_find_shared(uint32_t* parents, uint32_t step)
+{
+    for(;;)
+    {
+        uint32_t parent = __atomic_load_n(&parents[step], __ATOMIC_ACQUIRE);
+        if(parent == step) return step;
+
+        uint32_t grandparent = __atomic_load_n(&parents[parent], __ATOMIC_ACQUIRE);
+        if(grandparent != parent)
+            __atomic_compare_exchange_n(&parents[step], &parent, grandparent, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+
+        step = grandparent;
+    }
+}
+
+/** \brief Joins the trees of steps `a` and `b`, and returns false if they
+ *  were already one tree. A root is only ever swapped for another while it
+ *  is still a root, so no join is lost to another thread.
+ */
+static bool kruskal_join_shared(uint32_t* parents, uint32_t a, uint32_t b)
+{
+    for(;;)
+    {
+        a = kruskal_find_shared(parents, a);
+        b = kruskal_find_shared(parents, b);
+        if(a == b) return false;
+
+        uint32_t root = a;
+        if(__atomic_compare_exchange_n(&parents[a], &root, b, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            return true;
+    }
+}
+
+// K R U S K A L //
+// ============= //
+
+bool kruskal_reset(maze_t* maze)
+{
+    int step = maze->params.step;
+    int columns = (maze->width + step - 1) / step;
+    int rows = (maze->height + step - 1) / step;
+
+    if((uint64_t)columns * rows > KRUSKAL_MAX_STEPS)
+    {
+        fprintf(stderr, "kruskal_reset() A maze can have at most %lu steps in MODE_KRUSKAL!\n", (unsigned long)KRUSKAL_MAX_STEPS);
+        return false;
+    }
+
+    kruskal_t* self = maze->kruskal;
+    uint32_t steps = (uint32_t)columns * rows;
+
+    if(self == NULL && (self = maze->kruskal = calloc(1, sizeof(kruskal_t))) == NULL)
+    {
+        fprintf(stderr, "kruskal_reset() Failed to allocate kruskal!\n");
+        return false;
+    }
+
+    if(self->parents == NULL || self->steps != steps)
+    {
+        free(self->parents);
+        if((self->parents = malloc(steps * sizeof(uint32_t))) == NULL)
+        {
+            fprintf(stderr, "kruskal_reset() Failed to allocate parents!\n");
+            return false;
+        }
+    }
+
+    free(self->order);
+    self->order = NULL;
+
+    self->columns = columns;
+    self->rows = rows;
+    self->steps = steps;
+    self->walls = (size_t)(columns - 1) * rows + (size_t)columns * (rows - 1);
+    self->next = 0;
+    self->joins = 0;
+    self->failed = false;
+    self->seed = maze->params.seed;
+
+    for(uint32_t i = 0; i < steps; i++)
+        self->parents[i] = i;
+
+    // Every step is a tree of its own to begin with.
+    for(int y = 0; y < rows; y++)
+    {
+        for(int x = 0; x < columns; x++)
+            map_set(&maze->map, x * step, y * step);
+    }
+
+    return true;
+}
+
+void kruskal_free(maze_t* maze)
+{
+    if(maze->kruskal == NULL) return;
+
+    free(maze->kruskal->parents);
+    free(maze->kruskal->order);
+    free(maze->kruskal);
+    maze->kruskal = NULL;
+}
+
+bool kruskal_done(const kruskal_t* self)
+{
+    return self->failed || self->joins + 1 >= self->steps;
+}
+
+void kruskal_update(maze_t* maze)
+{
+    kruskal_t* self = maze->kruskal;
+    if(kruskal_done(self)) return;
+
+    if(self->order == NULL && !kruskal_sort(self))
+    {
+        self->failed = true;
+        maze->failed = true;
+        return;
+    }
+
+    while(self->next < self->walls)
+    {
+        uint32_t wall = self->order[self->next++];
+
+        uint32_t a, b;
+        kruskal_ends(self, wall, &a, &b);
+
+        a = kruskal_find(self->parents, a);
+        b = kruskal_find(self->parents, b);
+        if(a == b) continue;
+
+        self->parents[a] = b;
+        kruskal_carve(maze, wall, false);
+
+        // The rest of the walls would all be turned down.
+        if(++self->joins + 1 >= self->steps)
+        {
+            free(self->order);
+            self->order = NULL;
+        }
+
+        return;
+    }
+}
+
+// B O R U V K A //
+// ============= //
+
+typedef struct boruvka_s {
+    maze_t* maze;
+    kruskal_t* kruskal;
+
+    /// Weight of the lightest wall out of each tree, by its root, or
+    /// KRUSKAL_NONE.
+    uint64_t* best;
+
+    /// Walls which may still join two trees. A worker keeps those of its
+    /// own steps in `walls[2 * first]` onwards.
+    uint32_t* walls;
+    size_t length;
+
+    /// Steps of this worker.
+    uint32_t first, last;
+
+    /// Walls knocked down by the last `boruvka_join()`.
+    size_t joins;
+
+    /// The first round reads the walls from the grid, not from `walls`.
+    bool fresh;
+
+    pthread_t thread;
+} boruvka_t;
+
+/** \brief Makes the wall of `weight` the best wall of `tree` if it is lighter.
+ */
+static void boruvka_offer(boruvka_t* self, uint32_t tree, uint64_t weight)
+{
+    uint64_t* best = &self->best[tree];
+    uint64_t held = __atomic_load_n(best, __ATOMIC_RELAXED);
+
+    while(weight < held)
+    {
+        if(__atomic_compare_exchange_n(best, &held, weight, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            return;
+    }
+}
+
+/** \brief Offers `wall` to the trees on either side, and keeps it for the
+ *  next round, unless it is inside one tree, where it stays for good.
+ */
+static void boruvka_consider(boruvka_t* self, uint32_t wall)
+{
+    uint32_t a, b;
+    kruskal_ends(self->kruskal, wall, &a, &b);
+
+    a = kruskal_find_shared(self->kruskal->parents, a);
+    b = kruskal_find_shared(self->kruskal->parents, b);
+    if(a == b) return;
+
+    uint64_t weight = kruskal_weight(self->kruskal, wall);
+    boruvka_offer(self, a, weight);
+    boruvka_offer(self, b, weight);
+
+    self->walls[(size_t)self->first * 2 + self->length++] = wall;
+}
+
+/** \brief First half of a round: every tree picks its lightest wall.
+ */
+static void* boruvka_pick(void* arg)
+{
+    boruvka_t* self = arg;
+    const kruskal_t* kruskal = self->kruskal;
+
+    if(self->fresh)
+    {
+        self->length = 0;
+
+        for(uint32_t step = self->first; step < self->last; step++)
+        {
+            if(step % kruskal->columns != (uint32_t)kruskal->columns - 1)
+                boruvka_consider(self, step * 2);
+
+            if(step / kruskal->columns != (uint32_t)kruskal->rows - 1)
+                boruvka_consider(self, step * 2 + 1);
+        }
+    }
+    else
+    {
+        // Walls are kept in place, behind the ones being read.
+        size_t length = self->length;
+        uint32_t* walls = self->walls + (size_t)self->first * 2;
+
+        self->length = 0;
+        for(size_t i = 0; i < length; i++)
+            boruvka_consider(self, walls[i]);
+    }
+
+    return NULL;
+}
+
+/** \brief Second half of a round: the picked walls are knocked down. No
+ *  two walls picked in a round can close a loop, but a wall picked by the
+ *  trees on both of its sides is only knocked down once.
+ */
+static void* boruvka_join(void* arg)
+{
+    boruvka_t* self = arg;
+
+    self->joins = 0;
+    for(uint32_t step = self->first; step < self->last; step++)
+    {
+        uint64_t weight = self->best[step];
+        if(weight == KRUSKAL_NONE) continue;
+
+        self->best[step] = KRUSKAL_NONE;
+
+        // The wall is the bottom half of its weight.
+        uint32_t wall = (uint32_t)weight;
+
+        uint32_t a, b;
+        kruskal_ends(self->kruskal, wall, &a, &b);
+
+        if(kruskal_join_shared(self->kruskal->parents, a, b))
+        {
+            kruskal_carve(self->maze, wall, true);
+            self->joins++;
+        }
+    }
+
+    return NULL;
+}
+
+/** \brief Runs `phase` on every worker, each on its own thread but the
+ *  first, which runs on this one.
+ */
+static void boruvka_phase(boruvka_t* workers, int count, void* (*phase)(void*))
+{
+    bool started[count];
+
+    for(int i = 1; i < count; i++)
+        started[i] = pthread_create(&workers[i].thread, NULL, phase, &workers[i]) == 0;
+
+    phase(&workers[0]);
+
+    for(int i = 1; i < count; i++)
+    {
+        if(started[i])
+            pthread_join(workers[i].thread, NULL);
+        else
+            phase(&workers[i]);
+    }
+}
+
+bool kruskal_run(maze_t* maze, int threads)
+{
+    kruskal_t* self = maze->kruskal;
+    if(kruskal_done(self)) return !self->failed;
+
+    if(threads < 1) threads = 1;
+    if((uint32_t)threads > self->steps) threads = self->steps;
+
+    MAZE_STAT(uint64_t start = maze_clock_ns());
+
+    uint64_t* best = malloc(self->steps * sizeof(uint64_t));
+    uint32_t* walls = malloc((size_t)self->steps * 2 * sizeof(uint32_t));
+    boruvka_t* workers = calloc(threads, sizeof(boruvka_t));
+    if(best == NULL || walls == NULL || workers == NULL)
+    {
+        fprintf(stderr, "kruskal_run() Failed to allocate workers!\n");
+        free(best);
+        free(walls);
+        free(workers);
+        maze->failed = true;
+        return false;
+    }
+
+    // Every byte 0xff makes every wall KRUSKAL_NONE.
+    memset(best, 0xff, self->steps * sizeof(uint64_t));
+
+    for(int i = 0; i < threads; i++)
+    {
+        workers[i].maze = maze;
+        workers[i].kruskal = self;
+        workers[i].best = best;
+        workers[i].walls = walls;
+        workers[i].first = (uint64_t)self->steps * i / threads;
+        workers[i].last = (uint64_t)self->steps * (i + 1) / threads;
+        workers[i].fresh = true;
+    }
+
+    // Each round at least halves the number of trees. //
+    size_t joins = 1;
+    while(joins && !kruskal_done(self))
+    {
+        boruvka_phase(workers, threads, boruvka_pick);
+        boruvka_phase(workers, threads, boruvka_join);
+
+        joins = 0;
+        for(int i = 0; i < threads; i++)
+        {
+            joins += workers[i].joins;
+            workers[i].fresh = false;
+        }
+
+        self->joins += joins;
+    }
+
+    // The sorted walls, if `maze_update()` got that far, are not needed.
+    free(self->order);
+    self->order = NULL;
+    self->next = self->walls;
+
+    free(best);
+    free(walls);
+    free(workers);
+
+    MAZE_STAT(maze->stats.run_ns += maze_clock_ns() - start);
+    return true;
+}
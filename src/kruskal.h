@@ -0,0 +1,108 @@
+
+/** kruskal.h, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * Generates mazes with Kruskal's algorithm. Every wall between two steps
+ * gets a weight hashed from the seed, and walls are knocked down in order
+ * of weight unless the steps on either side are already joined. Since no
+ * two walls weigh the same, the result is the minimum spanning tree of
+ * the grid, and any algorithm which finds that tree makes the same maze.
+ *
+ * `maze_update()` runs Kruskal's algorithm itself, knocking down one wall
+ * per update, so the viewer can show it. `kruskal_run()` finds the same
+ * tree with Boruvka's algorithm instead, which needs no sorted wall list
+ * and is spread over any number of threads: each round, every tree picks
+ * its lightest wall to a neighbouring tree, and those walls are knocked
+ * down through a lock-free union-find.
+ */
+
+#ifndef MAZEGEN_KRUSKAL_H
+#define MAZEGEN_KRUSKAL_H
+
+#include "maze.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/// Heavier than any wall, for a tree which has not picked one yet.
+#define KRUSKAL_NONE UINT64_MAX
+
+/// Walls are numbered `2 * step + 0` for the wall to the right of a step
+/// and `2 * step + 1` for the wall below it, so a maze can have at most
+/// this many steps.
+#define KRUSKAL_MAX_STEPS (UINT32_MAX / 2)
+
+typedef struct kruskal_s {
+    /// Number of steps across and down, and in all.
+    int columns, rows;
+    uint32_t steps;
+
+    /// Union-find over the steps, with the trees joined so far.
+    uint32_t* parents;
+
+    /// Walls in order of weight, built by the first `maze_update()`, and
+    /// the next one to try.
+    uint32_t* order;
+    size_t walls, next;
+
+    /// Walls knocked down so far. The maze is done at `steps - 1`.
+    size_t joins;
+
+    /// Set if `order` could not be built, which ends the maze early and
+    /// sets `failed` in the maze too.
+    bool failed;
+
+    uint64_t seed;
+} kruskal_t;
+
+/** \brief Sets up `self->kruskal` for the maze in `self->params`, and
+ *  makes every step floor. Called by `maze_reset()`.
+ *
+ * \param self maze_t*
+ * \return bool
+ */
+bool kruskal_reset(maze_t* self);
+void kruskal_free(maze_t* self);
+
+/** \brief The kernel of MODE_KRUSKAL: knocks down the next wall which
+ *  joins two trees.
+ *
+ * \param self maze_t*
+ * \return void
+ */
+void kruskal_update(maze_t* self);
+
+/** \brief Returns true once every step is joined.
+ *
+ * \param self const kruskal_t*
+ * \return bool
+ */
+bool kruskal_done(const kruskal_t* self);
+
+/** \brief Finishes the maze with Boruvka's algorithm on `threads`
+ *  threads. The maze is the same as the one `maze_run()` makes, whatever
+ *  the number of threads.
+ *
+ * \param self maze_t*
+ * \param threads int
+ * \return bool
+ */
+bool kruskal_run(maze_t* self, int threads);
+
+#endif // MAZEGEN_KRUSKAL_H
@@ -17,102 +17,194 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>
  */
 
-#include "blist.h"
-
-#include <SDL.h>
+#include "maze.h"
+#include "batch.h"
+#include "checkpoint.h"
+#include "eller.h"
+#include "image.h"
+#include "kruskal.h"
+#include "tiled.h"
+#include "viewer.h"
 
 #include <stdbool.h>
+#include <limits.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <math.h>
 #include <time.h>
+#include <unistd.h>
 
-// P R O T O T Y P E S //
-// =================== //
+// G L O B A L S //
+// ============= //
 
-bool init();
-void quit();
+static int window_width = 800, window_height = 640;
 
-void input();
+static int fps = 60;
+static int speed = 10;
 
-bool out_of_bounds(int x, int y);
-bool can_move(int x, int y);
+static int depth = 1;
+static image_scale_t scale = {1, 1};
+static int wall = 0;
 
-void update();
-void render();
+static maze_params_t params;
+static maze_t maze = {0};
 
-bool saveBMP();
+static int tile = 0;
+static int threads = 0;
 
-// P O I N T //
-// ========= //
+static bool quiet = false;
+static bool parallel = false;
+static bool validate = false;
+static bool in_place = false;
 
-typedef struct point_s {
-    int x, y;
-} point_t;
+static bool stats = false;
+static double progress = 0;
 
-// P A T H S //
-// ========= //
+static const char* checkpoint_path = NULL;
+static double checkpoint_every = 600;
+static const char* resume_path = NULL;
 
-typedef struct paths_s {
-    int _[5];
-} paths_t;
+static const char* default_outfile = "maze.bmp";
+static const char* default_pattern = "maze-%d.bmp";
+static const char* outfile = NULL;
 
-paths_t get_paths(point_t* point);
-int count_paths(point_t* point);
+static bool batch = false;
+static long batch_first = 0, batch_last = 0;
+static const char* manifest = NULL;
 
-// H E A D //
-// ======= //
+static tiled_region_t* regions = NULL;
+static int region_count = 0;
 
-typedef struct head_s {
-    point_t point;
-    int direction;
+// F U N C T I O N S //
+// ================= //
 
-    blist_t branches;
-} head_t;
+/** \brief Returns the number of processors which are online, or 1 if
+ *  that can't be told.
+ */
+static int online_processors()
+{
+#ifdef _SC_NPROCESSORS_ONLN
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if(count > 0) return count < INT_MAX ? count : INT_MAX;
+#endif
+    return 1;
+}
 
-// G L O B A L S //
-// ============= //
+/** \brief Generates every maze of the batch given on the command line.
+ */
+static int run_batch()
+{
+    batch_t self;
+    const char* pattern = outfile ? outfile : default_pattern;
 
-enum {
-    MODE_RANDOM_SWITCHING = 1,
-    MODE_DEPTH_FIRST = 2,
-    MODE_BREADTH_FIRST = 3,
+    bool ok = batch_init(&self, &params, tile, depth, &scale, validate);
 
-    MOVE_UP = 1,
-    MOVE_RIGHT = 2,
-    MOVE_DOWN = 3,
-    MOVE_LEFT = 4,
-};
+    if(ok && batch) ok = batch_add_range(&self, batch_first, batch_last, pattern);
+    if(ok && manifest) ok = batch_add_manifest(&self, manifest, pattern);
 
-static SDL_Window* window = NULL;
-static SDL_Renderer* renderer = NULL;
+    if(ok)
+    {
+        printf("Generating %zu mazes on %d thread%s.\n", self.jobs->length, threads, threads == 1 ? "" : "s");
 
-static int window_width = 800, window_height = 640;
+        if(batch_run(&self, threads))
+            printf("Saved %zu mazes!\n", self.jobs->length);
+        else
+            fprintf(stderr, "error: %zu of %zu mazes failed.\n", self.failed, self.jobs->length);
 
-static int delay = 100; // 10 FPS.
+        ok = self.failed == 0;
+    }
 
-static int step = 2;
-static int numHeads = 1;
+    batch_free(&self);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
 
-static int maze_width = 20, maze_height = 20;
+/** \brief Generates the regions of the tiled maze given on the command
+ *  line, sharing them out like the mazes of a batch.
+ */
+static int run_regions()
+{
+    batch_t self;
+    const char* pattern = outfile ? outfile : (region_count == 1) ? default_outfile : default_pattern;
 
-static int switch_chance = 10;
+    bool ok = batch_init(&self, &params, tile, depth, NULL, false);
+    if(ok) ok = batch_add_regions(&self, regions, region_count, pattern);
 
-static int mode = MODE_DEPTH_FIRST;
+    if(ok)
+    {
+        printf("Generating %d region%s on %d thread%s.\n", region_count, region_count == 1 ? "" : "s", threads, threads == 1 ? "" : "s");
 
-static blist_t* heads = NULL;
+        if(batch_run(&self, threads))
+            printf("Saved %d region%s!\n", region_count, region_count == 1 ? "" : "s");
+        else
+            fprintf(stderr, "error: %zu of %d regions failed.\n", self.failed, region_count);
 
-static char* map = NULL;
-static int maze_width, maze_height;
+        ok = self.failed == 0;
+    }
 
-static int cellSize, xp, yp;
+    batch_free(&self);
+    free(regions);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
 
-static bool quiet = false;
-static bool running = true;
+#ifdef MAZE_STATS
+/** \brief Prints to stderr how far the maze has got, if it has been
+ *  `progress` seconds since it was last printed.
+ */
+static void show_progress(uint64_t start, uint64_t* shown)
+{
+    uint64_t now = maze_clock_ns();
+    if(now - *shown < progress * 1e9) return;
+    *shown = now;
 
-static const char* default_outfile = "maze.bmp";
-static const char* outfile = NULL;
+    maze_stats_t counts;
+    maze_get_stats(&maze, &counts);
+
+    double steps = (double)params.width * params.height - 1;
+    double seconds = (now - start) * 1e-9;
+    double done = counts.steps < steps ? counts.steps / steps : 1;
+    double eta = done > 0 ? seconds * (1 - done) / done : 0;
+
+    fprintf(stderr, "%5.1f%%  %.0f cells/s  %.0fs left\n", done * 100, counts.cells / seconds, eta);
+}
+#endif
+
+/** \brief Runs the maze until it is done. With -progress or -checkpoint
+ *  it runs in chunks, between which progress is shown and checkpoints
+ *  are started.
+ */
+static void run_maze()
+{
+    if(progress <= 0 && checkpoint_path == NULL)
+    {
+        maze_run(&maze);
+        return;
+    }
+
+    checkpoint_t checkpoint;
+    if(checkpoint_path != NULL)
+        checkpoint_init(&checkpoint, checkpoint_path, checkpoint_every);
+
+#ifdef MAZE_STATS
+    uint64_t start = maze_clock_ns(), shown = start;
+#endif
+
+    while(!maze_done(&maze))
+    {
+        maze_step(&maze, 4096);
+
+        // A failed maze has lost branches, so isn't worth resuming.
+        if(checkpoint_path != NULL && !maze.failed)
+            checkpoint_update(&checkpoint, &maze);
+
+#ifdef MAZE_STATS
+        if(progress > 0)
+            show_progress(start, &shown);
+#endif
+    }
+
+    if(checkpoint_path != NULL && !checkpoint_finish(&checkpoint))
+        fprintf(stderr, "warning: %zu of %zu checkpoints failed.\n", checkpoint.failed, checkpoint.written);
+}
 
 // M A I N //
 // ======= //
@@ -124,22 +216,55 @@ int main(int argc, char** argv)
         printf("usage: mazegen [options]\n");
         printf("  -h                        Shows this help message.\n");
         printf("  -w <width> <height>       Width and height of the viewer window. Default 800x640.\n");
-        printf("  -f -fps <number>          FPS of the viewer. Default 10.\n");
+        printf("  -f -fps <number>          FPS of the viewer, or 0 to match the display. Default 60.\n");
+        printf("  -speed <steps>            Steps per second shown by the viewer, or 0 for as fast as possible. Default 10.\n");
         printf("  -s -size <width> <height> Width and height of the maze. Default 20x20.\n");
-        printf("  -m -mode <name>           Method used to generate the maze. One of 'random', 'depth', 'breadth'. Default 'depth'.\n");
+        printf("  -m -mode <name>           Method used to generate the maze. One of 'random', 'depth', 'breadth', 'eller',\n");
+        printf("                            'kruskal'. Default 'depth'.\n");
         printf("  -switch <chance>          Chance (0-100) that a head will switch to another branch. Default 10.\n");
+        printf("  -ordered                  Keep branch order when switching in 'random' mode. Slower on big mazes.\n");
+        printf("  -layout <name>            How steps are laid out in memory, 'rows' or 'blocks' of 16x16 steps. The maze is the\n");
+        printf("                            same either way. 'blocks' is experimental, and not faster so far. Default 'rows'.\n");
         printf("  -step <size>              Number of steps the head takes in any direction. Default 2.\n");
         printf("  -h -heads <number>        Number of heads that create the maze. Default 1.\n");
+        printf("  -parallel                 Runs each head on its own thread. Mazes differ from run to run, even with a seed.\n");
+        printf("  -validate                 Checks that the finished maze is a perfect maze.\n");
+        printf("  -tile <size>              Generates the maze in tiles of this many steps, keeping only one row of tiles in memory.\n");
+        printf("  -threads <number>         Number of threads used to generate tiles, mazes of a batch, or a maze in 'kruskal'\n");
+        printf("                            mode. Default: one per processor.\n");
+        printf("  -batch <first> <last>     Generates the mazes with seeds first to last, saving each to the -o path with its seed\n");
+        printf("                            in place of a %%d, such as 'maze-%%04d.png'. Default path 'maze-%%d.bmp'.\n");
+        printf("  -manifest <path>          Generates the mazes listed in a file, one per line as a seed and an optional path.\n");
+        printf("                            Lines without a path use the -o path, as for -batch.\n");
+        printf("  -region <x0> <y0> <x1> <y1>\n");
+        printf("                            Saves only pixels x0 to x1 - 1 and y0 to y1 - 1 of the image of a -tile maze, frame\n");
+        printf("                            included, generating only the tiles they cross. Give it more than once for several\n");
+        printf("                            regions at once, saved to the -o path with their number in place of a %%d.\n");
         printf("  -q                        A window wont be created which shows the maze generation.\n");
         printf("  -seed <seed>              Seed used for random number generation. Default RANDOM.\n");
-        printf("  -o <path>                 Saves the final state of the maze to this file. Default 'maze.bmp'.\n");
+        printf("  -o <path>                 Saves the final state of the maze to this file, as .png, .bmp, .raw, or .mzt\n");
+        printf("                            (2 bits per step, see tree.h). Default 'maze.bmp'.\n");
+        printf("  -depth <bits>             Bits per pixel of the saved image. 1, 8 or 24 for .bmp, 1 or 8 for .png. Default 1.\n");
+        printf("  -scale <pixels>           Pixels across each cell of the maze becomes in the saved image. Default 1.\n");
+        printf("  -wall <pixels>            Pixels across the walls between steps, and the frame, instead of the -scale.\n");
+        printf("  -mmap                     Creates the 1-bit .bmp or .raw output file first and generates the maze straight\n");
+        printf("                            into it, for mazes as big as memory.\n");
+        printf("  -stats                    Prints counters and timings of the generation as JSON once the maze is saved.\n");
+        printf("  -progress <seconds>       Prints how far generation has got, cells per second and time left this often.\n");
+        printf("  -checkpoint <path>        Saves the state of the maze to this file as it is generated, for -resume.\n");
+        printf("  -every <seconds>          Time between checkpoints. Default 600.\n");
+        printf("  -resume <path>            Carries on the maze in a checkpoint, making the same maze as a run which was never\n");
+        printf("                            stopped. Its size and options replace those given.\n");
+#ifndef MAZE_STATS
+        printf("This build keeps no statistics, so -stats and -progress need it built with -DMAZE_STATS.\n");
+#endif
+#ifndef MAZEGEN_VIEWER
+        printf("This build has no viewer, so it always runs as if -q was given.\n");
+#endif
         return EXIT_SUCCESS;
     }
 
-    if(!init()) return 1;
-
-    outfile = default_outfile;
-    long seed = 0;
+    maze_default_params(&params);
 
     // Parse command-line arguments. //
     for(int i = 1; i < argc; i++)
@@ -151,442 +276,451 @@ int main(int argc, char** argv)
         }
         else if(strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "-size") == 0)
         {
-            maze_width = atoi(argv[++i]);
-            maze_height = atoi(argv[++i]);
+            params.width = atoi(argv[++i]);
+            params.height = atoi(argv[++i]);
         }
         else if(strcmp(argv[i], "-m") == 0 || strcmp(argv[i], "-mode") == 0)
         {
             if(strcmp(argv[i + 1], "random") == 0)
             {
-                mode = MODE_RANDOM_SWITCHING;
+                params.mode = MODE_RANDOM_SWITCHING;
             }
             else if(strcmp(argv[i + 1], "depth") == 0)
             {
-                mode = MODE_DEPTH_FIRST;
+                params.mode = MODE_DEPTH_FIRST;
             }
             else if(strcmp(argv[i + 1], "breadth") == 0)
             {
-                mode = MODE_BREADTH_FIRST;
+                params.mode = MODE_BREADTH_FIRST;
+            }
+            else if(strcmp(argv[i + 1], "eller") == 0)
+            {
+                params.mode = MODE_ELLER;
+            }
+            else if(strcmp(argv[i + 1], "kruskal") == 0)
+            {
+                params.mode = MODE_KRUSKAL;
             }
         }
         else if(strcmp(argv[i], "-step") == 0)
         {
-            step = atoi(argv[++i]);
+            params.step = atoi(argv[++i]);
         }
         else if(strcmp(argv[i], "-switch") == 0)
         {
-            switch_chance = atoi(argv[++i]);
+            params.switch_chance = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-ordered") == 0)
+        {
+            params.ordered = true;
+        }
+        else if(strcmp(argv[i], "-layout") == 0)
+        {
+            if(strcmp(argv[++i], "blocks") == 0)
+                params.layout = MAZE_LAYOUT_BLOCKS;
+            else
+                params.layout = MAZE_LAYOUT_ROWS;
         }
         else if(strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "-heads") == 0)
         {
-            numHeads = atoi(argv[++i]);
+            params.heads = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-parallel") == 0)
+        {
+            parallel = true;
+        }
+        else if(strcmp(argv[i], "-validate") == 0)
+        {
+            validate = true;
+        }
+        else if(strcmp(argv[i], "-tile") == 0)
+        {
+            tile = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-threads") == 0)
+        {
+            threads = atoi(argv[++i]);
         }
         else if(strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "-fps") == 0)
         {
-            int fps = atoi(argv[++i]);
-            if(fps)
-            {
-                delay = 1000 / fps;
-            }
-            else
-            {
-                delay = 0;
-            }
+            fps = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-speed") == 0)
+        {
+            speed = atoi(argv[++i]);
         }
         else if(strcmp(argv[i], "-q") == 0 || strcmp(argv[i], "-quiet") == 0)
         {
             quiet = true;
-            delay = 0;
         }
         else if(strcmp(argv[i], "-seed") == 0)
         {
-            seed = atoi(argv[++i]);
+            params.seed = strtol(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "-batch") == 0)
+        {
+            batch = true;
+            batch_first = strtol(argv[++i], NULL, 10);
+            batch_last = strtol(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "-manifest") == 0)
+        {
+            manifest = argv[++i];
+        }
+        else if(strcmp(argv[i], "-region") == 0)
+        {
+            tiled_region_t* grown = realloc(regions, (region_count + 1) * sizeof(tiled_region_t));
+            if(grown == NULL)
+            {
+                fprintf(stderr, "error: failed to allocate regions.\n");
+                return EXIT_FAILURE;
+            }
+
+            regions = grown;
+            regions[region_count].x0 = atoi(argv[++i]);
+            regions[region_count].y0 = atoi(argv[++i]);
+            regions[region_count].x1 = atoi(argv[++i]);
+            regions[region_count].y1 = atoi(argv[++i]);
+            region_count++;
         }
         else if(strcmp(argv[i], "-o") == 0)
         {
             outfile = argv[++i];
         }
+        else if(strcmp(argv[i], "-depth") == 0)
+        {
+            depth = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-scale") == 0)
+        {
+            scale.floor = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-wall") == 0)
+        {
+            wall = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-mmap") == 0)
+        {
+            in_place = true;
+        }
+        else if(strcmp(argv[i], "-stats") == 0)
+        {
+            stats = true;
+        }
+        else if(strcmp(argv[i], "-progress") == 0)
+        {
+            progress = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-checkpoint") == 0)
+        {
+            checkpoint_path = argv[++i];
+        }
+        else if(strcmp(argv[i], "-every") == 0)
+        {
+            checkpoint_every = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-resume") == 0)
+        {
+            resume_path = argv[++i];
+        }
     }
 
-    if(maze_width == 1 || maze_height == 1)
+    if(resume_path != NULL && (tile || batch || manifest))
     {
-        fprintf(stderr, "error: both maze dimensions must be greater than 1.\n");
-        return EXIT_SUCCESS;
+        printf("Tiled mazes and batches can't be checkpointed, so -resume is ignored.\n");
+        resume_path = NULL;
     }
 
-    // Set maze width and height. //
-    maze_width = maze_width * step - 1;
-    maze_height = maze_height * step - 1;
-
-    // Seed prng. //
-    if(seed == 0) seed = time(NULL);
-    printf("Running with seed: %ld\n", seed);
-    srand(seed);
-
-    if(!quiet)
+    // A resumed maze is the maze in the checkpoint, whatever was asked.
+    if(resume_path != NULL)
     {
-        // Initialise window and renderer. //
-        window = SDL_CreateWindow("mazegen", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, window_width, window_height, SDL_WINDOW_SHOWN);
-        if(window == NULL)
-        {
-            fprintf(stderr, "Window could not be created! SDL Error: %s\n", SDL_GetError());
-            quit();
+        if(!checkpoint_read_params(resume_path, &params))
             return EXIT_FAILURE;
-        }
 
-        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-        if(renderer == NULL)
-        {
-            fprintf(stderr, "Renderer could not be created! SDL Error: %s\n", SDL_GetError());
-            quit();
-            return EXIT_FAILURE;
-        }
+        printf("Resuming the maze in '%s'.\n", resume_path);
+
+        if(parallel) printf("Resumed mazes run on one thread, so -parallel is ignored.\n");
+        parallel = false;
     }
 
-    // Initialise cellSize and padding.
-    cellSize = fmin(window_width / maze_width, window_height / maze_height);
-    xp = (window_width - (cellSize * maze_width)) / 2;
-    yp = (window_height - (cellSize * maze_height)) / 2;
+    if(checkpoint_path != NULL && (tile || batch || manifest || parallel || params.mode == MODE_ELLER || params.mode == MODE_KRUSKAL))
+    {
+        printf("Only a maze run one step at a time on one thread can be checkpointed, so -checkpoint is ignored.\n");
+        checkpoint_path = NULL;
+    }
 
-    // Initialise maze map. //
-    map = calloc(maze_width * maze_height, 1);
-    if(map == NULL)
+    if(params.width < 2 || params.height < 2)
     {
-        fprintf(stderr, "Failed to allocate maze map!\n");
-        quit();
+        fprintf(stderr, "error: both maze dimensions must be greater than 1.\n");
         return EXIT_FAILURE;
     }
 
-    // Initialise heads. //
-    heads = blist_create(numHeads, sizeof(head_t));
-    if(heads == NULL)
+    if(params.step < 1)
     {
-        fprintf(stderr, "Failed to allocate heads list!\n");
-        quit();
+        fprintf(stderr, "error: the step must be at least 1.\n");
         return EXIT_FAILURE;
     }
 
-    for(int i = 0; i < numHeads; i++)
+    if(params.heads < 1 || params.heads > USHRT_MAX)
     {
-        head_t head = {{rand() % (maze_width / step) * step, rand() % (maze_height / step) * step}, rand() % 4, {0}};
-        if(!blist_init(&head.branches, 10, sizeof(point_t)))
-        {
-            fprintf(stderr, "Failed to allocate head branches list!\n");
-            quit();
-            return EXIT_FAILURE;
-        }
-
-        blist_push(heads, &head);
-
-        map[head.point.y * maze_width + head.point.x] = 1;
+        fprintf(stderr, "error: the number of heads must be from 1 to %d.\n", USHRT_MAX);
+        return EXIT_FAILURE;
     }
 
-    while(heads->length && running)
+    if((long long)params.width * params.step > INT_MAX - 2 || (long long)params.height * params.step > INT_MAX - 2)
     {
-        clock_t start = clock();
-
-        input();
-        update();
-
-        if(!quiet) render();
-
-        if(delay)
-        {
-            int dl = delay - (clock() - start);
-            if(dl > 0) SDL_Delay(dl);
-        }
+        fprintf(stderr, "error: the maze is too big.\n");
+        return EXIT_FAILURE;
     }
 
-    if(saveBMP()) printf("Saved maze to '%s'!\n", outfile);
+    if(threads < 1) threads = online_processors();
 
-    if(!quiet)
+    if(params.mode == MODE_ELLER && tile)
     {
-        // Loop until the user quits.
-        while(running)
-        {
-            input();
-            SDL_Delay(20);
-        }
+        printf("Mazes of 'eller' mode are streamed row by row already, so -tile is ignored.\n");
+        tile = 0;
     }
 
-    quit();
-    return EXIT_SUCCESS;
-}
+    scale.wall = wall ? wall : scale.floor;
+    if(scale.floor < 1 || scale.wall < 1)
+    {
+        fprintf(stderr, "error: cells must be scaled to at least 1 pixel.\n");
+        return EXIT_FAILURE;
+    }
 
-// F U N C T I O N S //
-// ================= //
+    bool scaled = scale.floor != 1 || scale.wall != 1;
 
-bool init()
-{
-    // Initialise SDL. //
-    if(SDL_Init(SDL_INIT_VIDEO) < 0)
+    if(in_place && (tile || batch || manifest || params.mode == MODE_ELLER))
     {
-        fprintf(stderr, "SDL could not initialise! SDL Error: %s\n", SDL_GetError());
-        return false;
+        printf("Streamed mazes and batches never hold a whole maze in memory, so -mmap is ignored.\n");
+        in_place = false;
     }
 
-    return true;
-}
-
-void quit()
-{
-    if(heads != NULL)
-        blist_destroy(heads);
+    if(in_place && scaled)
+    {
+        printf("Scaled images are written as they are streamed, so -mmap is ignored.\n");
+        in_place = false;
+    }
 
-    if(map != NULL)
-        free(map);
+#ifndef MAZE_STATS
+    if(stats || progress > 0)
+    {
+        printf("This build keeps no statistics, so -stats and -progress are ignored. Build it with -DMAZE_STATS.\n");
+        stats = false;
+        progress = 0;
+    }
+#endif
 
-    // Close SDL. //
-    if(SDL_WasInit(0) > 0)
+    if((stats || progress > 0) && (tile || batch || manifest || params.mode == MODE_ELLER))
     {
-        if(window != NULL)
-            SDL_DestroyWindow(window);
+        printf("Statistics are only kept for a single maze which is not streamed, so -stats and -progress are ignored.\n");
+        stats = false;
+        progress = 0;
+    }
 
-        if(renderer != NULL)
-            SDL_DestroyRenderer(renderer);
+    if(tile && tile < 2)
+    {
+        fprintf(stderr, "error: tiles must be at least 2 steps across.\n");
+        return EXIT_FAILURE;
+    }
 
-        SDL_Quit();
+    if(region_count && (batch || manifest))
+    {
+        printf("Batches save whole mazes, so -region is ignored.\n");
+        region_count = 0;
     }
-}
 
-void input()
-{
-    SDL_Event event;
-    while(SDL_PollEvent(&event))
+    // Regions are windows of a tiled maze, saved like a batch. //
+    if(region_count)
     {
-        switch(event.type)
+        if(params.mode == MODE_ELLER || !tile)
         {
-            case SDL_QUIT:
-                running = false;
-                break;
-
-            case SDL_KEYDOWN:
+            fprintf(stderr, "error: -region needs -tile, and a mode other than 'eller', since the tiles decide the maze it is part of.\n");
+            return EXIT_FAILURE;
+        }
 
-                if(event.key.keysym.scancode == SDL_SCANCODE_ESCAPE)
-                    running = false;
-                break;
+        if(scaled) printf("Regions are saved a pixel to a cell, so -scale and -wall are ignored.\n");
+        if(validate) printf("Regions can't be validated, since they are only part of a maze.\n");
+        if(parallel) printf("Regions are made of tiles, which run on one thread each, so -parallel is ignored.\n");
 
-            case SDL_KEYUP:
+        if(params.seed == 0) params.seed = time(NULL);
+        printf("Running with seed: %ld\n", params.seed);
 
-                if(event.key.keysym.scancode == SDL_SCANCODE_MINUS)
-                {
-                    delay += 20;
-                }
-                else if(event.key.keysym.scancode == SDL_SCANCODE_EQUALS)
-                {
-                    if(delay >= 20) delay -= 20;
-                }
-        }
+        return run_regions();
     }
-}
 
-bool out_of_bounds(int x, int y)
-{
-    if(x < 0 || x >= maze_width || y < 0 || y >= maze_height)
-        return true;
+    // A batch has its own seeds and paths, and is never shown. //
+    if(batch || manifest)
+    {
+        if(parallel) printf("Mazes of a batch run on one thread each, so -parallel is ignored.\n");
+        if((tile || params.mode == MODE_ELLER) && validate)
+            printf("Streamed mazes can't be validated, since they are never all in memory.\n");
 
-    return false;
-}
+        return run_batch();
+    }
 
-bool can_move(int x, int y)
-{
-    if(!out_of_bounds(x, y) && map[y * maze_width + x] == 0)
-        return true;
+    if(outfile == NULL) outfile = default_outfile;
 
-    return false;
-}
+    int format = image_format_from_path(outfile);
+    if(!image_supports(format, depth))
+    {
+        fprintf(stderr, "error: %d-bit images can't be saved as '%s'.\n", depth, outfile);
+        return EXIT_FAILURE;
+    }
 
-paths_t get_paths(point_t* point)
-{
-    paths_t paths = {0};
-    int index = 1;
+    if(format == IMAGE_TREE && scaled)
+    {
+        printf(".mzt files hold steps rather than pixels, so -scale and -wall are ignored.\n");
+        scale.floor = scale.wall = 1;
+    }
 
-    if(can_move(point->x, point->y - step))
-        paths._[index++] = MOVE_UP;
+    // Seed prng. //
+    if(params.seed == 0) params.seed = time(NULL);
+    printf("Running with seed: %ld\n", params.seed);
 
-    if(can_move(point->x + step, point->y))
-        paths._[index++] = MOVE_RIGHT;
+    if(params.mode == MODE_ELLER)
+    {
+        if(validate) printf("Mazes of 'eller' mode can't be validated, since they are never all in memory.\n");
 
-    if(can_move(point->x, point->y + step))
-        paths._[index++] = MOVE_DOWN;
+        if(!eller_generate(&params, outfile, format, depth, &scale))
+            return EXIT_FAILURE;
 
-    if(can_move(point->x - step, point->y))
-        paths._[index++] = MOVE_LEFT;
+        printf("Saved maze to '%s'!\n", outfile);
+        return EXIT_SUCCESS;
+    }
 
-    paths._[0] = index - 1;
+    if(tile)
+    {
+        if(validate) printf("Tiled mazes can't be validated, since they are never all in memory.\n");
 
-    return paths;
-}
+        if(!tiled_generate(&params, tile, threads, outfile, format, depth, &scale))
+            return EXIT_FAILURE;
 
-int count_paths(point_t* point)
-{
-    return get_paths(point)._[0];
-}
+        printf("Saved maze to '%s'!\n", outfile);
+        return EXIT_SUCCESS;
+    }
 
-void head_push_branch(head_t* head, point_t* point)
-{
-    point_t new_branch = {point->x, point->y};
-    blist_push(&head->branches, &new_branch);
-}
+    // With -mmap, the maze is generated straight into the pixels of the
+    // output file, which is done as soon as the maze is.
+    image_mapping_t mapping = {0};
 
-void head_switch_branch(head_t* head)
-{
-    point_t branch;
-    if(mode == MODE_RANDOM_SWITCHING)
-    {
-        // Select a random branch from branches.
-        size_t index = rand() % head->branches.length;
-        blist_copyget(&head->branches, index, &branch);
-        blist_remove(&head->branches, index);
-    }
-    else if(mode == MODE_DEPTH_FIRST)
+    if(in_place)
     {
-        // Select branch at top of branches.
-        blist_copyget(&head->branches, head->branches.length - 1, &branch);
-        blist_pop(&head->branches);
+        int width = params.width * params.step - 1, height = params.height * params.step - 1;
+        if(!image_map(&mapping, outfile, format, depth, width + 2, height + 2))
+        {
+            image_unmap(&mapping);
+            return EXIT_FAILURE;
+        }
     }
-    else if(mode == MODE_BREADTH_FIRST)
+
+    if(in_place ? !maze_init_buffer(&maze, &params, mapping.pixels, mapping.pixels_size) : !maze_init(&maze, &params))
     {
-        // Select branch at bottom of branches.
-        blist_copyget(&head->branches, 0, &branch);
-        blist_remove(&head->branches, 0);
+        fprintf(stderr, "Failed to initialise maze!\n");
+        maze_free(&maze);
+        image_unmap(&mapping);
+        return EXIT_FAILURE;
     }
 
-    // Push head to branches if head has any paths.
-    if(count_paths(&head->point)) head_push_branch(head, &head->point);
-
-    // Set head to this branch.
-    head->point.x = branch.x;
-    head->point.y = branch.y;
-}
-
-void update()
-{
-    bool removed = false;
-    for(size_t i = 0; i < heads->length; i++)
+    if(resume_path != NULL && !checkpoint_load(&maze, resume_path))
     {
-        head_t* head = blist_get(heads, i);
+        maze_free(&maze);
+        image_unmap(&mapping);
+        return EXIT_FAILURE;
+    }
 
-        // In MODE_RANDOM_SWITCHING, switch to a new branch with switch_chance probability.
-        if(mode == MODE_RANDOM_SWITCHING && head->branches.length > 0 && rand() % 100 + 1 <= switch_chance)
-            head_switch_branch(head);
+    bool running = true;
 
-        // Switch branches until the head has paths or no branches remain.
-        while(count_paths(&head->point) == 0)
-        {
-            if(head->branches.length == 0)
-            {
-                // No paths and no branches, remove this head.
-                free(head->branches.array);
-                blist_remove(heads, i--);
-                removed = true;
-                break;
-            }
+#ifndef MAZEGEN_VIEWER
+    quiet = true;
+#endif
 
-            head_switch_branch(head);
-        }
+    // The viewer would run the maze itself.
+    if(checkpoint_path != NULL || resume_path != NULL)
+        quiet = true;
 
-        if(removed)
+    // Unless it is shown, a maze in 'kruskal' mode is spread over every
+    // thread, and comes out the same as on one.
+    if(params.mode == MODE_KRUSKAL && (quiet || parallel))
+    {
+        if(!kruskal_run(&maze, threads))
         {
-            removed = false;
-            continue;
+            maze_free(&maze);
+            image_unmap(&mapping);
+            return EXIT_FAILURE;
         }
+    }
+    else if(parallel && !maze_run_parallel(&maze))
+    {
+        maze_free(&maze);
+        image_unmap(&mapping);
+        return EXIT_FAILURE;
+    }
 
-        // Move the head in a random available direction.
-        paths_t paths = get_paths(&head->point);
-
-        int direction = paths._[rand() % paths._[0] + 1];
-
-        point_t old_head = {head->point.x, head->point.y};
-
-        for(int i = 0; i < step; i++)
+#ifdef MAZEGEN_VIEWER
+    if(!quiet)
+    {
+        if(!viewer_init(&maze, window_width, window_height, fps, speed))
         {
-            if(direction == MOVE_UP)
-            {
-                head->point.y--;
-            }
-            else if(direction == MOVE_RIGHT)
-            {
-                head->point.x++;
-            }
-            else if(direction == MOVE_DOWN)
-            {
-                head->point.y++;
-            }
-            else if(direction == MOVE_LEFT)
-            {
-                head->point.x--;
-            }
-
-            map[head->point.y * maze_width + head->point.x] = 1;
+            viewer_quit();
+            maze_free(&maze);
+            image_unmap(&mapping);
+            return EXIT_FAILURE;
         }
 
-        // Push a branch if the old head had any paths.
-        if(count_paths(&old_head)) head_push_branch(head, &old_head);
-
-        head->direction = direction;
+        running = viewer_run(&maze);
     }
-}
+#endif
 
-void render()
-{
-    SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0xFF);
-    SDL_RenderClear(renderer);
+    // Mazes run on several threads are done by now.
+    if(running) run_maze();
 
-    // Render map. //
-    SDL_SetRenderDrawColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF);
-    for(int y = 0; y < maze_height; y++)
+    if(maze.failed)
     {
-        for(int x = 0; x < maze_width; x++)
-        {
-            if(map[y * maze_width + x] == 1)
-            {
-                SDL_Rect cell = {x * cellSize + xp, y * cellSize + yp, cellSize, cellSize};
-                SDL_RenderFillRect(renderer, &cell);
-            }
-        }
+        fprintf(stderr, "Failed to generate maze!\n");
+#ifdef MAZEGEN_VIEWER
+        if(!quiet) viewer_quit();
+#endif
+        maze_free(&maze);
+        image_unmap(&mapping);
+        return EXIT_FAILURE;
     }
 
-    // Render heads. //
-    SDL_SetRenderDrawColor(renderer, 0xFF, 0x40, 0x40, 0xFF);
-    for(size_t i = 0; i < heads->length; i++)
+    int status = EXIT_SUCCESS;
+    if(validate && maze_done(&maze))
     {
-        head_t* head = blist_get(heads, i);
+        MAZE_STAT(uint64_t start = maze_clock_ns());
 
-        SDL_Rect headr = {head->point.x * cellSize + xp, head->point.y * cellSize + yp, cellSize, cellSize};
-        SDL_RenderFillRect(renderer, &headr);
+        if(maze_validate(&maze))
+            printf("The maze is a perfect maze.\n");
+        else
+            status = EXIT_FAILURE;
+
+        MAZE_STAT(maze.stats.validate_ns = maze_clock_ns() - start);
     }
 
-    SDL_RenderPresent(renderer);
-}
+    MAZE_STAT(uint64_t start = maze_clock_ns());
 
-// U T I L I T I E S //
-// ================= //
+    bool saved = in_place ? image_unmap(&mapping) : image_save_maze(&maze, outfile, format, depth, &scale);
+    if(saved) printf("Saved maze to '%s'!\n", outfile);
 
-bool saveBMP()
-{
-    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, maze_width + 2, maze_height + 2, 24, SDL_PIXELFORMAT_RGB24);
-    if(surface == NULL) return false;
+    // The maze is safe, so the run needn't be resumed.
+    if(saved && checkpoint_path != NULL)
+        remove(checkpoint_path);
 
-    for(int y = 0; y < maze_height; y++)
-    {
-        for(int x = 0; x < maze_width; x++)
-        {
-            if(map[y * maze_width + x] == 1)
-            {
-                SDL_Rect r = {x + 1, y + 1, 1, 1};
-                SDL_FillRect(surface, &r, 0xFFFFFF);
-            }
-        }
-    }
+#ifdef MAZE_STATS
+    maze.stats.save_ns = maze_clock_ns() - start;
+    if(stats) maze_print_stats(&maze, stdout);
+#endif
 
-    if(SDL_SaveBMP(surface, outfile) != 0)
+#ifdef MAZEGEN_VIEWER
+    if(!quiet)
     {
-        fprintf(stderr, "saveBMP() Failed to save bmp. SDL Error: %s\n", SDL_GetError());
-        SDL_FreeSurface(surface);
-        return false;
+        if(running) viewer_wait();
+        viewer_quit();
     }
+#endif
 
-    SDL_FreeSurface(surface);
-    return true;
+    maze_free(&maze);
+    return status;
 }
@@ -0,0 +1,131 @@
+
+/** map.c, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "map.h"
+
+#include <string.h>
+#include <stdio.h>
+
+/** \brief Sets the size of `self` and the layout of its rows.
+ */
+static void map_layout(map_t* self, int width, int height)
+{
+    // Round each row, frame included, up to a whole number of 32-bit words.
+    self->stride = (((size_t)width + 2 + 31) / 32) * 4;
+    self->size = self->stride * ((size_t)height + 2);
+    self->width = width;
+    self->height = height;
+}
+
+size_t map_size(int width, int height)
+{
+    map_t map;
+    map_layout(&map, width, height);
+    return map.size;
+}
+
+bool map_init(map_t* self, int width, int height)
+{
+    map_layout(self, width, height);
+    self->capacity = self->size;
+    self->owned = true;
+
+    self->bits = calloc(self->size, 1);
+    if(self->bits == NULL)
+    {
+        fprintf(stderr, "map_init() Failed to allocate %zu bytes for the map!\n", self->size);
+        return false;
+    }
+
+    return true;
+}
+
+bool map_init_buffer(map_t* self, int width, int height, void* buffer, size_t capacity)
+{
+    map_layout(self, width, height);
+    self->capacity = capacity;
+    self->owned = false;
+    self->bits = buffer;
+
+    if(buffer == NULL || capacity < self->size)
+    {
+        fprintf(stderr, "map_init_buffer() A %dx%d map needs %zu bytes, but the buffer has %zu!\n", width, height, self->size, capacity);
+        return false;
+    }
+
+    memset(self->bits, 0, self->size);
+    return true;
+}
+
+void map_free(map_t* self)
+{
+    if(self->owned) free(self->bits);
+    self->bits = NULL;
+}
+
+void map_blit(map_t* self, int x, int y, const map_t* src)
+{
+    // Whole source rows are ORed in, frame and padding included; those
+    // bits are always 0, so they leave `self` as it was. A source left of
+    // `self` is read from the first byte with a cell inside it instead.
+    int shift = x >= 0 ? x & 7 : (-x) & 7;
+    size_t offset = x >= 0 ? (size_t)x >> 3 : 0;
+    size_t skip = x >= 0 ? 0 : (size_t)-(long)x >> 3;
+
+    // Cells which land in the frame or padding of `self` are cleared
+    // again, since both are always walls.
+    bool left = x < 0, right = (long)x + src->width > self->width;
+    size_t end = (size_t)self->width + 1;
+
+    for(int row = y < 0 ? -y : 0; row < src->height && y + row < self->height; row++)
+    {
+        const unsigned char* in = map_row(src, row) + skip;
+        unsigned char* out = map_row(self, y + row);
+
+        if(x >= 0)
+        {
+            for(size_t i = 0; i < src->stride && offset + i < self->stride; i++)
+            {
+                if(in[i] == 0) continue;
+
+                out[offset + i] |= in[i] >> shift;
+                if(shift && offset + i + 1 < self->stride)
+                    out[offset + i + 1] |= (unsigned char)(in[i] << (8 - shift));
+            }
+        }
+        else
+        {
+            for(size_t i = 0; skip + i < src->stride && i < self->stride; i++)
+            {
+                out[i] |= (unsigned char)(in[i] << shift);
+                if(shift && skip + i + 1 < src->stride)
+                    out[i] |= in[i + 1] >> (8 - shift);
+            }
+        }
+
+        if(left)
+            out[0] &= 0x7F;
+
+        if(right)
+        {
+            out[end >> 3] &= (unsigned char)(0xFF00 >> (end & 7));
+            memset(out + (end >> 3) + 1, 0, self->stride - (end >> 3) - 1);
+        }
+    }
+}
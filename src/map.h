@@ -0,0 +1,147 @@
+
+/** map.h, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * A map stores one bit per cell, 1 for floor and 0 for wall.
+ *
+ * Rows are laid out like the rows of a 1-bit image: the leftmost cell is
+ * the most significant bit of the first byte, and each row is padded to a
+ * multiple of 4 bytes. The map is surrounded by a one cell frame of walls,
+ * so a row can be handed to an image writer as it is.
+ */
+
+#ifndef MAZEGEN_MAP_H
+#define MAZEGEN_MAP_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+typedef struct map_s {
+    unsigned char* bits;
+    size_t stride, size;
+
+    /// Bytes available at `bits`, which may be more than `size`.
+    size_t capacity;
+
+    /// False if `bits` belongs to the caller of `map_init_buffer()`.
+    bool owned;
+
+    /// Size in cells, not counting the frame.
+    int width, height;
+} map_t;
+
+/** \brief Allocates a map of `width` by `height` cells, all walls.
+ *
+ * \param self map_t*
+ * \param width int
+ * \param height int
+ * \return bool
+ */
+bool map_init(map_t* self, int width, int height);
+
+/** \brief Lays out a map of `width` by `height` cells, all walls, in the
+ *  `capacity` bytes at `buffer`, which must be at least `map_size()`
+ *  bytes. The buffer still belongs to the caller, `map_free()` won't
+ *  free it.
+ *
+ * \param self map_t*
+ * \param width int
+ * \param height int
+ * \param buffer void*
+ * \param capacity size_t
+ * \return bool
+ */
+bool map_init_buffer(map_t* self, int width, int height, void* buffer, size_t capacity);
+void map_free(map_t* self);
+
+/** \brief Returns the number of bytes a map of `width` by `height`
+ *  cells takes, frame included.
+ *
+ * \param width int
+ * \param height int
+ * \return size_t
+ */
+size_t map_size(int width, int height);
+
+/** \brief Sets every cell which is floor in `src` to floor in `self`,
+ *  with the top left cell of `src` at `x`, `y`, which may be negative.
+ *  Cells which fall outside of `self` are skipped.
+ *
+ * \param self map_t*
+ * \param x int
+ * \param y int
+ * \param src const map_t*
+ * \return void
+ */
+void map_blit(map_t* self, int x, int y, const map_t* src);
+
+/** \brief Returns a pointer to the bytes of row `y`, including the
+ *  frame. `y` may be -1 or `height` to get the top or bottom frame row.
+ *
+ * \param self map_t*
+ * \param y int
+ * \return unsigned char*
+ */
+static inline unsigned char* map_row(const map_t* self, int y)
+{
+    return self->bits + (size_t)(y + 1) * self->stride;
+}
+
+static inline bool map_get(const map_t* self, int x, int y)
+{
+    const unsigned char* byte = &map_row(self, y)[(x + 1) >> 3];
+
+    // A relaxed load is a plain load, but lets other threads claim
+    // cells in the same byte at the same time.
+#ifdef __GNUC__
+    return (__atomic_load_n(byte, __ATOMIC_RELAXED) >> (7 - ((x + 1) & 7))) & 1;
+#else
+    return (*byte >> (7 - ((x + 1) & 7))) & 1;
+#endif
+}
+
+static inline void map_set(map_t* self, int x, int y)
+{
+    map_row(self, y)[(x + 1) >> 3] |= 0x80 >> ((x + 1) & 7);
+}
+
+/** \brief Atomically sets a cell to floor, and returns true if it was a
+ *  wall before. Several threads may claim cells of the same map at once,
+ *  and only one of them will get a given cell.
+ *
+ * \param self map_t*
+ * \param x int
+ * \param y int
+ * \return bool
+ */
+static inline bool map_claim(map_t* self, int x, int y)
+{
+    unsigned char* byte = &map_row(self, y)[(x + 1) >> 3];
+    unsigned char bit = 0x80 >> ((x + 1) & 7);
+
+#ifdef __GNUC__
+    return !(__atomic_fetch_or(byte, bit, __ATOMIC_RELAXED) & bit);
+#else
+    bool was_wall = !(*byte & bit);
+    *byte |= bit;
+    return was_wall;
+#endif
+}
+
+#endif // MAZEGEN_MAP_H
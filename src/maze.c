@@ -0,0 +1,1620 @@
+
+/** maze.c, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "maze.h"
+#include "kruskal.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <stdbool.h>
+#include <limits.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+// P A T H S //
+// ========= //
+
+typedef struct paths_s {
+    int _[5];
+} paths_t;
+
+paths_t get_paths(maze_t* maze, point_t* point);
+int count_paths(maze_t* maze, point_t* point);
+
+bool maze_join_regions(maze_t* self);
+
+// F U N C T I O N S //
+// ================= //
+
+void maze_default_params(maze_params_t* params)
+{
+    params->width = 20;
+    params->height = 20;
+    params->step = 2;
+    params->heads = 1;
+    params->mode = MODE_DEPTH_FIRST;
+    params->switch_chance = 10;
+    params->ordered = false;
+    params->layout = MAZE_LAYOUT_ROWS;
+    params->seed = 0;
+}
+
+/// Most address space the branches lists of a maze reserve between them,
+/// see arena.h. A list which gets bigger than its share is moved, which
+/// only very big mazes, or heads with far more than their share, need.
+#define BRANCHES_RESERVE_MAX ((size_t)1 << 30)
+
+/// With MAZE_STATS, one branch switch in this many is timed. A power of 2.
+#define BRANCH_SAMPLE 64
+
+/// Capacity of a new branches list, and the first `limit` of a head.
+#define BRANCHES_INITIAL 10
+
+/// Functions the update kernels are built from. They are always inlined,
+/// so that each kernel gets its own copy with its mode and step folded in.
+#ifdef __GNUC__
+#define KERNEL_INLINE static inline __attribute__((always_inline))
+#else
+#define KERNEL_INLINE static inline
+#endif
+
+/// Steps across and down a block of MAZE_LAYOUT_BLOCKS, as a shift.
+#define BLOCK_SHIFT 4
+#define BLOCK_MASK ((1 << BLOCK_SHIFT) - 1)
+
+/** \brief Returns the index of the step at cell `x`, `y`, in a maze with
+ *  steps of `step` cells. Every array of steps is indexed through this.
+ */
+KERNEL_INLINE size_t maze_node_at(const maze_t* maze, int x, int y, int step)
+{
+    size_t column = x / step, row = y / step;
+
+    if(maze->params.layout == MAZE_LAYOUT_BLOCKS)
+    {
+        size_t block = (row >> BLOCK_SHIFT) * maze->block_columns + (column >> BLOCK_SHIFT);
+        return block << (2 * BLOCK_SHIFT) | (row & BLOCK_MASK) << BLOCK_SHIFT | (column & BLOCK_MASK);
+    }
+
+    return row * maze->params.width + column;
+}
+
+static size_t maze_node(const maze_t* maze, int x, int y)
+{
+    return maze_node_at(maze, x, y, maze->params.step);
+}
+
+// M A S K S //
+// ========= //
+
+/// Bit of a mask for each direction.
+#define MASK(direction) (1 << ((direction) - 1))
+
+/// Directions with a bit in each mask, in the order `get_paths()` used to
+/// find them by reading the map.
+static const paths_t mask_paths[16] = {
+    {{0}},
+    {{1, MOVE_UP}},
+    {{1, MOVE_RIGHT}},
+    {{2, MOVE_UP, MOVE_RIGHT}},
+    {{1, MOVE_DOWN}},
+    {{2, MOVE_UP, MOVE_DOWN}},
+    {{2, MOVE_RIGHT, MOVE_DOWN}},
+    {{3, MOVE_UP, MOVE_RIGHT, MOVE_DOWN}},
+    {{1, MOVE_LEFT}},
+    {{2, MOVE_UP, MOVE_LEFT}},
+    {{2, MOVE_RIGHT, MOVE_LEFT}},
+    {{3, MOVE_UP, MOVE_RIGHT, MOVE_LEFT}},
+    {{2, MOVE_DOWN, MOVE_LEFT}},
+    {{3, MOVE_UP, MOVE_DOWN, MOVE_LEFT}},
+    {{3, MOVE_RIGHT, MOVE_DOWN, MOVE_LEFT}},
+    {{4, MOVE_UP, MOVE_RIGHT, MOVE_DOWN, MOVE_LEFT}},
+};
+
+static const int step_dx[] = {0, 0, 1, 0, -1};
+static const int step_dy[] = {0, -1, 0, 1, 0};
+
+/** \brief Returns the mask of step `node`: a bit for each direction
+ *  with a step which is in the maze and not yet visited.
+ */
+KERNEL_INLINE int maze_node_mask(const maze_t* self, size_t node)
+{
+    // Relaxed, since parallel heads clear bits of the same byte.
+#ifdef __GNUC__
+    unsigned char byte = __atomic_load_n(&self->masks[node >> 1], __ATOMIC_RELAXED);
+#else
+    unsigned char byte = self->masks[node >> 1];
+#endif
+
+    return (byte >> ((node & 1) * 4)) & 0xF;
+}
+
+/** \brief Clears the bits of `bits` in the mask of step `node`. With
+ *  `shared`, other threads may be changing the same byte.
+ */
+KERNEL_INLINE void maze_clear_mask(maze_t* self, size_t node, int bits, bool shared)
+{
+    unsigned char keep = ~(bits << ((node & 1) * 4));
+
+#ifdef __GNUC__
+    if(shared)
+    {
+        __atomic_fetch_and(&self->masks[node >> 1], keep, __ATOMIC_RELAXED);
+        return;
+    }
+#else
+    (void) shared;
+#endif
+
+    self->masks[node >> 1] &= keep;
+}
+
+/** \brief Marks the step at `x`, `y` as visited, by clearing the bits of
+ *  its neighbours which point to it.
+ */
+KERNEL_INLINE void maze_visit(maze_t* self, int x, int y, int step, bool shared)
+{
+    size_t node = maze_node_at(self, x, y, step);
+    size_t up = self->params.width, down = up, left = 1, right = 1;
+
+    // In blocks, neighbours are in the same block but at its edges.
+    if(self->params.layout == MAZE_LAYOUT_BLOCKS)
+    {
+        size_t column = (x / step) & BLOCK_MASK, row = (y / step) & BLOCK_MASK;
+        size_t block = (size_t)1 << (2 * BLOCK_SHIFT), across = BLOCK_MASK << BLOCK_SHIFT;
+        size_t below = self->block_columns * block;
+
+        up = row ? BLOCK_MASK + 1 : below - across;
+        down = row < BLOCK_MASK ? BLOCK_MASK + 1 : below - across;
+        left = column ? 1 : block - BLOCK_MASK;
+        right = column < BLOCK_MASK ? 1 : block - BLOCK_MASK;
+    }
+
+    if(y >= step) maze_clear_mask(self, node - up, MASK(MOVE_DOWN), shared);
+    if(x + step < self->width) maze_clear_mask(self, node + right, MASK(MOVE_LEFT), shared);
+    if(y + step < self->height) maze_clear_mask(self, node + down, MASK(MOVE_UP), shared);
+    if(x >= step) maze_clear_mask(self, node - left, MASK(MOVE_RIGHT), shared);
+}
+
+/** \brief Allocates the masks, if they don't fit already, and sets every
+ *  step's mask to its neighbours in the maze.
+ */
+static bool maze_init_masks(maze_t* self)
+{
+    int step = self->params.step;
+    int columns = (self->width + step - 1) / step, rows = (self->height + step - 1) / step;
+
+    size_t size = (self->nodes + 1) / 2;
+    if(self->masks == NULL || self->masks_size != size)
+    {
+        free(self->masks);
+        self->masks = malloc(size);
+        self->masks_size = size;
+
+        if(self->masks == NULL)
+        {
+            fprintf(stderr, "maze_init_masks() Failed to allocate masks!\n");
+            return false;
+        }
+    }
+
+    memset(self->masks, 0, size);
+
+    for(int y = 0; y < rows; y++)
+    {
+        int row = MASK(MOVE_RIGHT) | MASK(MOVE_LEFT);
+        if(y > 0) row |= MASK(MOVE_UP);
+        if(y < rows - 1) row |= MASK(MOVE_DOWN);
+
+        for(int x = 0; x < columns; x++)
+        {
+            int mask = row;
+            if(x == 0) mask &= ~MASK(MOVE_LEFT);
+            if(x == columns - 1) mask &= ~MASK(MOVE_RIGHT);
+
+            size_t node = maze_node_at(self, x * step, y * step, step);
+            self->masks[node >> 1] |= mask << ((node & 1) * 4);
+        }
+    }
+
+    return true;
+}
+
+#ifdef MAZE_STATS
+uint64_t maze_clock_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/** \brief Adds the counters of `stats` to `total`, leaving out the
+ *  phase times, which only the maze keeps.
+ */
+static void maze_add_stats(maze_stats_t* total, const maze_stats_t* stats)
+{
+    total->steps += stats->steps;
+    total->cells += stats->cells;
+    total->switches_chance += stats->switches_chance;
+    total->switches_dead_end += stats->switches_dead_end;
+    total->dead_branches += stats->dead_branches;
+    total->branch_ns += stats->branch_ns;
+}
+#endif
+
+void head_free(void* head)
+{
+    blist_release(&((head_t*) head)->branches);
+}
+
+static void free_branches(void* branches)
+{
+    blist_release(branches);
+}
+
+/** \brief Removes the head at `index`, keeping its branches list for
+ *  the heads of the next maze, see `maze_reset()`.
+ */
+static void maze_retire_head(maze_t* self, size_t index)
+{
+    head_t* head = blist_get(self->heads, index);
+
+    self->peak_branches += head->peak;
+
+#ifdef MAZE_STATS
+    maze_add_stats(&self->stats, &head->stats);
+    if(self->head_peaks != NULL)
+        self->head_peaks[head->index] = head->peak;
+#endif
+
+    head->branches.length = 0;
+    if(!blist_push(self->spares, &head->branches))
+        blist_release(&head->branches);
+
+    head->branches.array = NULL;
+
+    blist_remove(self->heads, index);
+}
+
+bool maze_init(maze_t* self, const maze_params_t* params)
+{
+    self->map.bits = NULL;
+    self->heads = NULL;
+    self->spares = NULL;
+    self->arena = NULL;
+    self->owners = NULL;
+    self->masks = NULL;
+    self->kruskal = NULL;
+    self->dirty = NULL;
+    MAZE_STAT(self->head_peaks = NULL);
+
+    return maze_reset(self, params);
+}
+
+bool maze_init_buffer(maze_t* self, const maze_params_t* params, void* buffer, size_t size)
+{
+    self->heads = NULL;
+    self->spares = NULL;
+    self->arena = NULL;
+    self->owners = NULL;
+    self->masks = NULL;
+    self->kruskal = NULL;
+    self->dirty = NULL;
+    MAZE_STAT(self->head_peaks = NULL);
+
+    // Laid out by `maze_reset()`.
+    self->map.bits = buffer;
+    self->map.capacity = size;
+    self->map.owned = false;
+
+    if(buffer == NULL)
+    {
+        fprintf(stderr, "maze_init_buffer() No buffer was given!\n");
+        return false;
+    }
+
+    return maze_reset(self, params);
+}
+
+/** \brief Returns true if `maze_reset()` can make a maze with `params`,
+ *  printing why not if `report` is set.
+ */
+static bool maze_check_params(const maze_params_t* params, bool report)
+{
+    if(params->mode == MODE_ELLER)
+    {
+        if(report) fprintf(stderr, "maze_reset() Mazes of MODE_ELLER are made by eller_generate()!\n");
+        return false;
+    }
+
+    if(params->mode < MODE_RANDOM_SWITCHING || params->mode > MODE_KRUSKAL)
+    {
+        if(report) fprintf(stderr, "maze_reset() Unknown mode %d!\n", params->mode);
+        return false;
+    }
+
+    if(params->layout != MAZE_LAYOUT_ROWS && params->layout != MAZE_LAYOUT_BLOCKS)
+    {
+        if(report) fprintf(stderr, "maze_reset() Unknown layout %d!\n", params->layout);
+        return false;
+    }
+
+    if(params->width < 1 || params->height < 1)
+    {
+        if(report) fprintf(stderr, "maze_reset() A maze of %d by %d steps has no cells!\n", params->width, params->height);
+        return false;
+    }
+
+    if(params->step < 1)
+    {
+        if(report) fprintf(stderr, "maze_reset() Steps of %d cells can't be taken!\n", params->step);
+        return false;
+    }
+
+    if((long long)params->width * params->step > INT_MAX - 2 || (long long)params->height * params->step > INT_MAX - 2)
+    {
+        if(report) fprintf(stderr, "maze_reset() A maze of %d by %d steps of %d cells is too big!\n", params->width, params->height, params->step);
+        return false;
+    }
+
+    if(params->heads < 1 || params->heads > USHRT_MAX)
+    {
+        if(report) fprintf(stderr, "maze_reset() A maze needs from 1 to %d heads, not %d!\n", USHRT_MAX, params->heads);
+        return false;
+    }
+
+    return true;
+}
+
+size_t maze_buffer_size(const maze_params_t* params)
+{
+    if(!maze_check_params(params, false))
+        return 0;
+
+    return map_size(params->width * params->step - 1, params->height * params->step - 1);
+}
+
+maze_t* maze_create(const maze_params_t* params)
+{
+    maze_t* self = malloc(sizeof(maze_t));
+    if(self == NULL)
+    {
+        fprintf(stderr, "maze_create() Failed to allocate maze!\n");
+        return NULL;
+    }
+
+    if(!maze_init(self, params))
+    {
+        maze_destroy(self);
+        return NULL;
+    }
+
+    return self;
+}
+
+void maze_destroy(maze_t* self)
+{
+    maze_free(self);
+    free(self);
+}
+
+/// Defined with the kernels, further down.
+static void (*const kernels[3][4])(maze_t*);
+
+static bool maze_reset_in(maze_t* self, const maze_params_t* params);
+
+bool maze_reset(maze_t* self, const maze_params_t* params)
+{
+#ifdef MAZE_STATS
+    uint64_t start = maze_clock_ns();
+    bool reset = maze_reset_in(self, params);
+    self->stats.reset_ns = maze_clock_ns() - start;
+    return reset;
+#else
+    return maze_reset_in(self, params);
+#endif
+}
+
+static bool maze_reset_in(maze_t* self, const maze_params_t* params)
+{
+    int step = params->step;
+
+    if(!maze_check_params(params, true))
+        return false;
+
+    // Pick the kernel once, rather than test the mode on every update.
+    if(params->mode == MODE_KRUSKAL)
+        self->kernel = kruskal_update;
+    else
+        self->kernel = kernels[params->mode - 1][(step >= 1 && step <= 3) ? step : 0];
+
+    self->params = *params;
+    self->width = params->width * step - 1;
+    self->height = params->height * step - 1;
+
+    // Blocks are whole, even at the right and bottom edges.
+    self->block_columns = ((size_t)params->width + BLOCK_MASK) >> BLOCK_SHIFT;
+    if(params->layout == MAZE_LAYOUT_BLOCKS)
+        self->nodes = self->block_columns * (((size_t)params->height + BLOCK_MASK) >> BLOCK_SHIFT) << (2 * BLOCK_SHIFT);
+    else
+        self->nodes = (size_t)params->width * params->height;
+
+    self->peak_branches = 0;
+    self->failed = false;
+
+    // Seed prng. //
+    rng_seed(&self->rng, params->seed, 0);
+
+    // Initialise maze map, or clear it if it is already the right size. //
+    if(self->map.bits != NULL && !self->map.owned)
+    {
+        if(!map_init_buffer(&self->map, self->width, self->height, self->map.bits, self->map.capacity))
+            return false;
+    }
+    else if(self->map.bits != NULL && self->map.width == self->width && self->map.height == self->height)
+    {
+        memset(self->map.bits, 0, self->map.size);
+    }
+    else
+    {
+        if(self->map.bits != NULL) map_free(&self->map);
+        if(!map_init(&self->map, self->width, self->height))
+            return false;
+    }
+
+    // Initialise heads. //
+    if(self->arena == NULL && (self->arena = malloc(sizeof(arena_t))) != NULL)
+        arena_init(self->arena, 0);
+
+    if(self->arena == NULL)
+    {
+        fprintf(stderr, "maze_reset() Failed to allocate arena!\n");
+        return false;
+    }
+
+    // The lists never hold much more than one place per step between
+    // them, which doubling can take to two. That is shared out between
+    // the heads, so the address space reserved grows with the maze rather
+    // than with the number of heads, and a list which outgrows its share
+    // is moved to a bigger range.
+    size_t steps = (size_t)params->width * params->height;
+    size_t reserve = steps < BRANCHES_RESERVE_MAX / (2 * sizeof(point_t)) ? steps * 2 * sizeof(point_t) : BRANCHES_RESERVE_MAX;
+    arena_set_reserve(self->arena, reserve / params->heads);
+
+    blist_allocator_t allocator = arena_allocator(self->arena);
+
+    if(self->heads == NULL && (self->heads = blist_create_with(params->heads, sizeof(head_t), allocator)) != NULL)
+        self->heads->destructor = head_free;
+
+    if(self->spares == NULL && (self->spares = blist_create_with(params->heads, sizeof(blist_t), allocator)) != NULL)
+        self->spares->destructor = free_branches;
+
+    if(self->heads == NULL || self->spares == NULL)
+    {
+        fprintf(stderr, "maze_reset() Failed to allocate heads list!\n");
+        return false;
+    }
+
+    // Heads left over from an unfinished maze.
+    while(self->heads->length)
+        maze_retire_head(self, self->heads->length - 1);
+
+#ifdef MAZE_STATS
+    memset(&self->stats, 0, sizeof(maze_stats_t));
+
+    free(self->head_peaks);
+    self->head_peaks = calloc(params->heads, sizeof(size_t));
+    if(self->head_peaks == NULL && params->heads > 0)
+    {
+        fprintf(stderr, "maze_reset() Failed to allocate head peaks!\n");
+        return false;
+    }
+#endif
+
+    // With several heads, remember which tree each step belongs to. //
+    free(self->owners);
+    self->owners = NULL;
+
+    // Kruskal's algorithm has no heads, and keeps its own trees.
+    if(params->mode == MODE_KRUSKAL)
+        return kruskal_reset(self);
+
+    kruskal_free(self);
+
+    if(!maze_init_masks(self))
+        return false;
+
+    if(params->heads > 1)
+    {
+        self->owners = malloc(self->nodes * sizeof(unsigned short));
+        if(self->owners == NULL)
+        {
+            fprintf(stderr, "maze_reset() Failed to allocate owners!\n");
+            return false;
+        }
+    }
+
+    // Each head starts on a step of its own, so a step is only ever in one
+    // branches list. Heads start in all but the last row and column of
+    // steps (`rng_below(0)` is 0), and any beyond one per step are left out.
+    size_t starts = (size_t)(self->width / step ? self->width / step : 1) * (self->height / step ? self->height / step : 1);
+
+    for(int i = 0; i < params->heads && (size_t)i < starts; i++)
+    {
+        // Cleared rather than listed, since builds with MAZE_STATS add fields.
+        head_t head;
+        memset(&head, 0, sizeof(head_t));
+
+        // Draw in a fixed order, so every compiler places the heads alike,
+        // and again if another head is on that step already.
+        do
+        {
+            head.point.x = rng_below(&self->rng, self->width / step) * step;
+            head.point.y = rng_below(&self->rng, self->height / step) * step;
+        }
+        while(map_get(&self->map, head.point.x, head.point.y));
+
+        head.direction = rng_below(&self->rng, 4);
+        rng_seed(&head.rng, params->seed, i + 1);
+        head.limit = BRANCHES_INITIAL;
+        MAZE_STAT(head.index = i);
+
+        // Reuse the branches list of a head from an earlier maze.
+        if(self->spares->length)
+        {
+            // Not blist_pop(), which would free the list.
+            blist_copyget(self->spares, self->spares->length - 1, &head.branches);
+            self->spares->length--;
+        }
+        else if(!blist_init_with(&head.branches, BRANCHES_INITIAL, sizeof(point_t), allocator))
+        {
+            fprintf(stderr, "maze_reset() Failed to allocate head branches list!\n");
+            return false;
+        }
+
+        if(!blist_push(self->heads, &head))
+        {
+            blist_release(&head.branches);
+            return false;
+        }
+
+        // Count the first cell of each head, so `cells` ends up as the
+        // number of floor cells in the maze.
+        MAZE_STAT(self->stats.cells++);
+
+        if(self->owners != NULL)
+            self->owners[maze_node(self, head.point.x, head.point.y)] = i;
+
+        map_set(&self->map, head.point.x, head.point.y);
+        maze_visit(self, head.point.x, head.point.y, step, false);
+    }
+
+    return true;
+}
+
+void maze_free(maze_t* self)
+{
+    if(self->heads != NULL)
+        blist_destroy(self->heads);
+
+    if(self->spares != NULL)
+        blist_destroy(self->spares);
+
+    if(self->dirty != NULL)
+        blist_destroy(self->dirty);
+
+    self->heads = NULL;
+    self->spares = NULL;
+    self->dirty = NULL;
+
+    // Only once every list it keeps is gone.
+    free(self->arena);
+    self->arena = NULL;
+
+    free(self->owners);
+    self->owners = NULL;
+
+    free(self->masks);
+    self->masks = NULL;
+
+#ifdef MAZE_STATS
+    free(self->head_peaks);
+    self->head_peaks = NULL;
+#endif
+
+    kruskal_free(self);
+
+    if(self->map.bits != NULL)
+        map_free(&self->map);
+
+    self->map.bits = NULL;
+}
+
+/** \brief Marks the maze as failed, printing `message` unless it
+ *  already was. Safe to call from several threads.
+ */
+static void maze_fail(maze_t* self, const char* message)
+{
+    if(!__atomic_exchange_n(&self->failed, true, __ATOMIC_RELAXED))
+        fprintf(stderr, "%s\n", message);
+}
+
+void maze_carve(maze_t* self, int x, int y)
+{
+    map_set(&self->map, x, y);
+
+    if(self->dirty != NULL)
+    {
+        point_t cell = {x, y};
+        if(!blist_push(self->dirty, &cell))
+            maze_fail(self, "maze_carve() Failed to grow dirty list!");
+    }
+}
+
+bool maze_done(maze_t* self)
+{
+    if(self->failed)
+        return true;
+
+    if(self->kruskal != NULL)
+        return kruskal_done(self->kruskal);
+
+    return self->heads->length == 0;
+}
+
+size_t maze_step(maze_t* self, size_t count)
+{
+    MAZE_STAT(uint64_t start = maze_clock_ns());
+
+    size_t done = 0;
+    for(; done < count && !maze_done(self); done++)
+        maze_update(self);
+
+    MAZE_STAT(self->stats.run_ns += maze_clock_ns() - start);
+    return done;
+}
+
+bool maze_run(maze_t* self)
+{
+    MAZE_STAT(uint64_t start = maze_clock_ns());
+
+    while(!maze_done(self))
+        maze_update(self);
+
+    MAZE_STAT(self->stats.run_ns += maze_clock_ns() - start);
+    return !self->failed;
+}
+
+paths_t get_paths(maze_t* maze, point_t* point)
+{
+    return mask_paths[maze_node_mask(maze, maze_node(maze, point->x, point->y))];
+}
+
+int count_paths(maze_t* maze, point_t* point)
+{
+    return mask_paths[maze_node_mask(maze, maze_node(maze, point->x, point->y))]._[0];
+}
+
+/** \brief `count_paths()` for a maze with steps of `step` cells.
+ */
+KERNEL_INLINE int count_paths_at(maze_t* maze, point_t point, int step)
+{
+    return mask_paths[maze_node_mask(maze, maze_node_at(maze, point.x, point.y, step))]._[0];
+}
+
+size_t head_count_branches(head_t* head)
+{
+    return head->branches.length - head->first;
+}
+
+/** \brief Drops the branches of `head` which have no paths left,
+ *  keeping the order of the rest.
+ */
+static void head_compact_branches(maze_t* maze, head_t* head)
+{
+    point_t* branches = (point_t*) head->branches.array;
+    size_t kept = 0;
+
+    for(size_t i = head->first; i < head->branches.length; i++)
+    {
+        if(maze_node_mask(maze, maze_node(maze, branches[i].x, branches[i].y)))
+            branches[kept++] = branches[i];
+    }
+
+    MAZE_STAT(head->stats.dead_branches += head->branches.length - head->first - kept);
+
+    head->branches.length = kept;
+    head->first = 0;
+}
+
+bool head_push_branch(maze_t* maze, head_t* head, point_t* point)
+{
+    blist_t* branches = &head->branches;
+
+    // Each step is in at most one list, at most once: only the head on a
+    // step pushes it, and it got there by starting there, alone, or by
+    // carving the step or taking it off its list. But a branch stays in the list after its last path
+    // is taken. So before a full list grows, drop its dead branches, and
+    // only grow it if at least half of it is still alive. Each branch is
+    // then looked at a constant number of times on average.
+    //
+    // In MODE_RANDOM_SWITCHING this changes which branches are picked,
+    // so it is skipped with `ordered`, which keeps the order of branches
+    // when switching. That is also why it goes by `limit` rather than the
+    // capacity, which depends on how the list was used before.
+    if(branches->length == head->limit)
+    {
+        if(!maze->params.ordered)
+            head_compact_branches(maze, head);
+
+        if(branches->length * 2 > head->limit)
+            head->limit *= 2;
+    }
+
+    if(!blist_push(branches, point))
+    {
+        maze_fail(maze, "head_push_branch() Failed to grow branches list, the maze can't be finished!");
+        return false;
+    }
+
+    if(branches->length > head->peak)
+        head->peak = branches->length;
+
+    return true;
+}
+
+/** \brief Moves `head` to one of its branches, picked as `mode` says.
+ */
+KERNEL_INLINE void head_switch_branch_in(maze_t* maze, head_t* head, int mode, int step)
+{
+#ifdef MAZE_STATS
+    // Reading the clock costs about as much as a switch, so only one
+    // switch in BRANCH_SAMPLE is timed, and stands for the rest.
+    bool timed = ((head->stats.switches_chance + head->stats.switches_dead_end) & (BRANCH_SAMPLE - 1)) == 0;
+    uint64_t start = timed ? maze_clock_ns() : 0;
+#endif
+
+    // Branches are always point_t, and have no destructor to call.
+    point_t* branches = (point_t*) head->branches.array;
+    point_t branch;
+
+    if(mode == MODE_RANDOM_SWITCHING)
+    {
+        // Select a random branch from branches.
+        size_t index = rng_below(&head->rng, head->branches.length);
+        branch = branches[index];
+
+        if(maze->params.ordered)
+            blist_remove(&head->branches, index);
+        else
+            branches[index] = branches[--head->branches.length];
+    }
+    else if(mode == MODE_DEPTH_FIRST)
+    {
+        // Select branch at top of branches.
+        branch = branches[--head->branches.length];
+    }
+    else
+    {
+        // Select branch at bottom of branches. Branches are consumed
+        // from `first` and only moved down once half the list is spent.
+        branch = branches[head->first++];
+
+        if(head->first * 2 >= head->branches.length)
+        {
+            blist_shift(&head->branches, head->first);
+            head->first = 0;
+        }
+    }
+
+    // Push head to branches if head has any paths.
+    if(count_paths_at(maze, head->point, step)) head_push_branch(maze, head, &head->point);
+
+    // Set head to this branch.
+    head->point = branch;
+
+    MAZE_STAT(if(timed) head->stats.branch_ns += (maze_clock_ns() - start) * BRANCH_SAMPLE);
+}
+
+void head_switch_branch(maze_t* maze, head_t* head)
+{
+    head_switch_branch_in(maze, head, maze->params.mode, maze->params.step);
+}
+
+// K E R N E L S //
+// ============= //
+
+/** \brief Moves every head one step, in a maze of `mode` with steps of
+ *  `step` cells. Each kernel below calls this with constants, so it has
+ *  no tests on the mode and its address arithmetic is by a fixed step. A
+ *  `step` of 0 makes the generic kernel, which reads the step from the
+ *  maze.
+ */
+KERNEL_INLINE void maze_update_in(maze_t* self, int mode, int step)
+{
+    if(step == 0) step = self->params.step;
+
+    for(size_t i = 0; i < self->heads->length; i++)
+    {
+        head_t* head = blist_get(self->heads, i);
+
+        // In MODE_RANDOM_SWITCHING, switch to a new branch with switch_chance probability.
+        if(mode == MODE_RANDOM_SWITCHING && head_count_branches(head) > 0 && (int)rng_below(&head->rng, 100) + 1 <= self->params.switch_chance)
+        {
+            head_switch_branch_in(self, head, mode, step);
+            MAZE_STAT(head->stats.switches_chance++);
+        }
+
+        // Switch branches until the head has paths or no branches remain.
+        size_t node = maze_node_at(self, head->point.x, head->point.y, step);
+        int mask = maze_node_mask(self, node);
+
+        while(mask == 0 && head_count_branches(head) > 0)
+        {
+            head_switch_branch_in(self, head, mode, step);
+
+            node = maze_node_at(self, head->point.x, head->point.y, step);
+            mask = maze_node_mask(self, node);
+
+            MAZE_STAT(head->stats.switches_dead_end++);
+            MAZE_STAT(head->stats.dead_branches += mask == 0);
+        }
+
+        if(mask == 0)
+        {
+            // No paths and no branches, remove this head.
+            maze_retire_head(self, i--);
+            continue;
+        }
+
+        // Move the head in a random available direction.
+        const paths_t* paths = &mask_paths[mask];
+        int direction = paths->_[rng_below(&head->rng, paths->_[0]) + 1];
+
+        point_t old_head = head->point;
+        int dx = step_dx[direction], dy = step_dy[direction];
+
+        for(int k = 1; k <= step; k++)
+            maze_carve(self, old_head.x + dx * k, old_head.y + dy * k);
+
+        head->point.x = old_head.x + dx * step;
+        head->point.y = old_head.y + dy * step;
+
+        MAZE_STAT(head->stats.steps++);
+        MAZE_STAT(head->stats.cells += step);
+
+        maze_visit(self, head->point.x, head->point.y, step, false);
+
+        if(self->owners != NULL)
+            self->owners[maze_node_at(self, head->point.x, head->point.y, step)] = self->owners[node];
+
+        // Push a branch if the old head has any paths left.
+        if(maze_node_mask(self, node)) head_push_branch(self, head, &old_head);
+
+        head->direction = direction;
+    }
+
+    if(self->heads->length == 0 && !maze_join_regions(self))
+        self->failed = true;
+}
+
+#define MAZE_KERNEL(name, mode, step) \
+    static void name(maze_t* self) { maze_update_in(self, mode, step); }
+
+MAZE_KERNEL(update_random, MODE_RANDOM_SWITCHING, 0)
+MAZE_KERNEL(update_random_1, MODE_RANDOM_SWITCHING, 1)
+MAZE_KERNEL(update_random_2, MODE_RANDOM_SWITCHING, 2)
+MAZE_KERNEL(update_random_3, MODE_RANDOM_SWITCHING, 3)
+MAZE_KERNEL(update_depth, MODE_DEPTH_FIRST, 0)
+MAZE_KERNEL(update_depth_1, MODE_DEPTH_FIRST, 1)
+MAZE_KERNEL(update_depth_2, MODE_DEPTH_FIRST, 2)
+MAZE_KERNEL(update_depth_3, MODE_DEPTH_FIRST, 3)
+MAZE_KERNEL(update_breadth, MODE_BREADTH_FIRST, 0)
+MAZE_KERNEL(update_breadth_1, MODE_BREADTH_FIRST, 1)
+MAZE_KERNEL(update_breadth_2, MODE_BREADTH_FIRST, 2)
+MAZE_KERNEL(update_breadth_3, MODE_BREADTH_FIRST, 3)
+
+/// Kernels by mode, then by step, with the generic kernel first.
+static void (*const kernels[3][4])(maze_t*) = {
+    {update_random, update_random_1, update_random_2, update_random_3},
+    {update_depth, update_depth_1, update_depth_2, update_depth_3},
+    {update_breadth, update_breadth_1, update_breadth_2, update_breadth_3},
+};
+
+void maze_update(maze_t* self)
+{
+    self->kernel(self);
+}
+
+// J O I N I N G //
+// ============= //
+
+typedef struct door_s {
+    int x, y, direction;
+} door_t;
+
+static int region_find(int* parents, int region)
+{
+    while(parents[region] != region)
+    {
+        parents[region] = parents[parents[region]];
+        region = parents[region];
+    }
+
+    return region;
+}
+
+/** \brief Opens one door between each pair of trees which need it to
+ *  make the maze a single tree, picking doors at random along the
+ *  borders between trees. Returns false if the doors couldn't be
+ *  listed, leaving the maze in pieces.
+ */
+bool maze_join_regions(maze_t* self)
+{
+    if(self->owners == NULL) return true;
+
+    MAZE_STAT(uint64_t start = maze_clock_ns());
+
+    int step = self->params.step;
+    int* parents = malloc(self->params.heads * sizeof(int));
+    blist_t* doors = blist_create(0, sizeof(door_t));
+    bool ok = parents != NULL && doors != NULL;
+
+    if(step > 1 && ok)
+    {
+        // Every closed wall between steps of different trees is a candidate.
+        for(int y = 0; y < self->height; y += step)
+        {
+            for(int x = 0; x < self->width; x += step)
+            {
+                unsigned short owner = self->owners[maze_node(self, x, y)];
+
+                if(x + step < self->width && self->owners[maze_node(self, x + step, y)] != owner)
+                {
+                    door_t door = {x, y, MOVE_RIGHT};
+                    ok = ok && blist_push(doors, &door);
+                }
+
+                if(y + step < self->height && self->owners[maze_node(self, x, y + step)] != owner)
+                {
+                    door_t door = {x, y, MOVE_DOWN};
+                    ok = ok && blist_push(doors, &door);
+                }
+            }
+        }
+    }
+
+    if(step > 1 && ok)
+    {
+        for(int i = 0; i < self->params.heads; i++)
+            parents[i] = i;
+
+        // Kruskal's algorithm over the trees, in a random order.
+        for(size_t i = doors->length; i > 0; i--)
+        {
+            size_t j = rng_below(&self->rng, i);
+            door_t* door = blist_get(doors, j);
+
+            int a = region_find(parents, self->owners[maze_node(self, door->x, door->y)]);
+            int b = (door->direction == MOVE_RIGHT)
+                ? region_find(parents, self->owners[maze_node(self, door->x + step, door->y)])
+                : region_find(parents, self->owners[maze_node(self, door->x, door->y + step)]);
+
+            if(a != b)
+            {
+                parents[b] = a;
+                for(int k = 1; k < step; k++)
+                {
+                    if(door->direction == MOVE_RIGHT)
+                        maze_carve(self, door->x + k, door->y);
+                    else
+                        maze_carve(self, door->x, door->y + k);
+                }
+
+                MAZE_STAT(self->stats.cells += step - 1);
+            }
+
+            blist_swap_remove(doors, j);
+        }
+    }
+    else if(step > 1)
+    {
+        fprintf(stderr, "maze_join_regions() Failed to allocate doors, the maze is left in pieces!\n");
+    }
+
+    if(doors != NULL) blist_destroy(doors);
+    free(parents);
+
+    free(self->owners);
+    self->owners = NULL;
+
+    MAZE_STAT(self->stats.join_ns += maze_clock_ns() - start);
+    return ok || step <= 1;
+}
+
+// P A R A L L E L //
+// =============== //
+
+typedef struct worker_s {
+    maze_t* maze;
+    head_t* head;
+
+    struct worker_s* workers;
+    size_t index, count;
+
+    /// Number of workers which still have branches.
+    int* active;
+
+    /// -1 while the worker has no branches, 0 while it has some, or
+    /// the index plus one of a worker which wants some of them.
+    int request;
+
+    /// Set once a request of this worker has been answered.
+    int answered;
+
+    pthread_t thread;
+} worker_t;
+
+/** \brief Answers a pending request by moving the oldest half of this
+ *  worker's branches, which tend to lead to the largest unexplored
+ *  areas, to the asking worker.
+ */
+static void worker_answer(worker_t* self)
+{
+    int request = __atomic_load_n(&self->request, __ATOMIC_ACQUIRE);
+    if(request <= 0) return;
+
+    worker_t* thief = &self->workers[request - 1];
+    head_t* head = self->head;
+    size_t count = head_count_branches(head) / 2;
+
+    if(count)
+    {
+        for(size_t i = 0; i < count; i++)
+            head_push_branch(self->maze, thief->head, blist_get(&head->branches, head->first + i));
+
+        blist_shift(&head->branches, head->first + count);
+        head->first = 0;
+
+        // Count the thief as active before it is told, so `active`
+        // never drops to 0 while there is still work.
+        __atomic_add_fetch(self->active, 1, __ATOMIC_RELAXED);
+    }
+
+    __atomic_store_n(&self->request, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&thief->answered, 1, __ATOMIC_RELEASE);
+}
+
+static void worker_close(worker_t* self)
+{
+    int expected = 0;
+    while(!__atomic_compare_exchange_n(&self->request, &expected, -1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        // Someone asked for branches just as they ran out.
+        worker_answer(self);
+        expected = 0;
+    }
+
+    __atomic_sub_fetch(self->active, 1, __ATOMIC_RELEASE);
+}
+
+static bool worker_steal(worker_t* self)
+{
+    while(__atomic_load_n(self->active, __ATOMIC_ACQUIRE) > 0)
+    {
+        for(size_t i = 1; i < self->count; i++)
+        {
+            worker_t* victim = &self->workers[(self->index + i) % self->count];
+
+            int expected = 0;
+            if(!__atomic_compare_exchange_n(&victim->request, &expected, (int)self->index + 1, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+                continue;
+
+            while(!__atomic_load_n(&self->answered, __ATOMIC_ACQUIRE))
+                sched_yield();
+
+            self->answered = 0;
+
+            if(head_count_branches(self->head))
+            {
+                __atomic_store_n(&self->request, 0, __ATOMIC_RELEASE);
+                return true;
+            }
+        }
+
+        sched_yield();
+    }
+
+    return false;
+}
+
+static void worker_work(worker_t* self)
+{
+    maze_t* maze = self->maze;
+    head_t* head = self->head;
+    int step = maze->params.step;
+
+    for(;;)
+    {
+        // Another head lost branches, so the maze won't be finished.
+        if(__atomic_load_n(&maze->failed, __ATOMIC_RELAXED)) return;
+
+        worker_answer(self);
+
+        if(maze->params.mode == MODE_RANDOM_SWITCHING && head_count_branches(head) > 0 && (int)rng_below(&head->rng, 100) + 1 <= maze->params.switch_chance)
+        {
+            head_switch_branch(maze, head);
+            MAZE_STAT(head->stats.switches_chance++);
+        }
+
+        while(count_paths(maze, &head->point) == 0)
+        {
+            if(head_count_branches(head) == 0) return;
+
+            head_switch_branch(maze, head);
+
+            MAZE_STAT(head->stats.switches_dead_end++);
+            MAZE_STAT(head->stats.dead_branches += count_paths(maze, &head->point) == 0);
+        }
+
+        paths_t paths = get_paths(maze, &head->point);
+        int direction = paths._[rng_below(&head->rng, paths._[0]) + 1];
+
+        point_t old_head = {head->point.x, head->point.y};
+        point_t target = {old_head.x + step_dx[direction] * step, old_head.y + step_dy[direction] * step};
+
+        // Another head may have taken the step since it was looked at, and
+        // not cleared its bit yet. Clear it here, rather than spin on it.
+        if(!map_claim(&maze->map, target.x, target.y))
+        {
+            maze_clear_mask(maze, maze_node(maze, old_head.x, old_head.y), MASK(direction), true);
+            continue;
+        }
+
+        maze_visit(maze, target.x, target.y, step, true);
+
+        for(int i = 1; i < step; i++)
+            map_claim(&maze->map, old_head.x + step_dx[direction] * i, old_head.y + step_dy[direction] * i);
+
+        if(maze->owners != NULL)
+            maze->owners[maze_node(maze, target.x, target.y)] = maze->owners[maze_node(maze, old_head.x, old_head.y)];
+
+        head->point = target;
+        head->direction = direction;
+
+        MAZE_STAT(head->stats.steps++);
+        MAZE_STAT(head->stats.cells += step);
+
+        if(count_paths(maze, &old_head)) head_push_branch(maze, head, &old_head);
+    }
+}
+
+static void* worker_run(void* data)
+{
+    worker_t* self = data;
+
+    do
+    {
+        worker_work(self);
+        worker_close(self);
+    }
+    while(worker_steal(self));
+
+    return NULL;
+}
+
+bool maze_run_parallel(maze_t* self)
+{
+    if(self->kruskal != NULL)
+        return kruskal_run(self, self->params.heads);
+
+    MAZE_STAT(uint64_t start = maze_clock_ns());
+
+    size_t count = self->heads->length;
+    int active = count;
+
+    worker_t* workers = calloc(count, sizeof(worker_t));
+    bool* started = calloc(count, sizeof(bool));
+    if(workers == NULL || started == NULL)
+    {
+        fprintf(stderr, "maze_run_parallel() Failed to allocate workers!\n");
+        free(workers);
+        free(started);
+        return false;
+    }
+
+    for(size_t i = 0; i < count; i++)
+    {
+        workers[i].maze = self;
+        workers[i].head = blist_get(self->heads, i);
+        workers[i].workers = workers;
+        workers[i].index = i;
+        workers[i].count = count;
+        workers[i].active = &active;
+    }
+
+    for(size_t i = 0; i < count; i++)
+        started[i] = pthread_create(&workers[i].thread, NULL, worker_run, &workers[i]) == 0;
+
+    // Run any head which didn't get a thread on this one.
+    for(size_t i = 0; i < count; i++)
+    {
+        if(!started[i]) worker_run(&workers[i]);
+    }
+
+    for(size_t i = 0; i < count; i++)
+    {
+        if(started[i]) pthread_join(workers[i].thread, NULL);
+    }
+
+    free(workers);
+    free(started);
+
+    // Every head is out of branches.
+    while(self->heads->length)
+        maze_retire_head(self, self->heads->length - 1);
+
+    MAZE_STAT(self->stats.run_ns += maze_clock_ns() - start);
+
+    if(self->failed || !maze_join_regions(self))
+    {
+        self->failed = true;
+        return false;
+    }
+
+    return true;
+}
+
+// S T A T E //
+// ========= //
+
+static bool state_write(FILE* file, const void* data, size_t size)
+{
+    return size == 0 || fwrite(data, size, 1, file) == 1;
+}
+
+static bool state_read(FILE* file, void* data, size_t size)
+{
+    return size == 0 || fread(data, size, 1, file) == 1;
+}
+
+bool maze_save_state(const maze_t* self, FILE* file)
+{
+    if(self->kruskal != NULL || self->params.heads < 1)
+    {
+        fprintf(stderr, "maze_save_state() Only mazes with heads can be saved!\n");
+        return false;
+    }
+
+    unsigned char owned = self->owners != NULL;
+    size_t count = self->heads->length;
+
+    bool ok = state_write(file, &self->rng, sizeof(rng_t))
+        && state_write(file, &self->peak_branches, sizeof(size_t))
+        && state_write(file, self->map.bits, self->map.size)
+        && state_write(file, self->masks, self->masks_size)
+        && state_write(file, &owned, 1)
+        && (!owned || state_write(file, self->owners, self->nodes * sizeof(unsigned short)))
+        && state_write(file, &count, sizeof(size_t));
+
+    for(size_t i = 0; ok && i < count; i++)
+    {
+        const head_t* head = blist_get(self->heads, i);
+
+#ifdef MAZE_STATS
+        int index = head->index;
+#else
+        int index = i;
+#endif
+
+        // The limit too, since it decides when the list is compacted.
+        ok = state_write(file, &head->point, sizeof(point_t))
+            && state_write(file, &head->direction, sizeof(int))
+            && state_write(file, &head->first, sizeof(size_t))
+            && state_write(file, &head->peak, sizeof(size_t))
+            && state_write(file, &head->rng, sizeof(rng_t))
+            && state_write(file, &index, sizeof(int))
+            && state_write(file, &head->branches.length, sizeof(size_t))
+            && state_write(file, &head->limit, sizeof(size_t))
+            && state_write(file, head->branches.array, head->branches.length * sizeof(point_t));
+    }
+
+    if(!ok) fprintf(stderr, "maze_save_state() Failed to write state!\n");
+
+    return ok;
+}
+
+bool maze_load_state(maze_t* self, FILE* file)
+{
+    if(self->kruskal != NULL || self->params.heads < 1)
+    {
+        fprintf(stderr, "maze_load_state() Only mazes with heads can be loaded!\n");
+        return false;
+    }
+
+    // The heads placed by `maze_reset()` make way for the saved ones.
+    while(self->heads->length)
+        maze_retire_head(self, self->heads->length - 1);
+
+    size_t nodes = (size_t)self->params.width * self->params.height;
+    unsigned char owned = 0;
+    size_t count = 0;
+
+    bool ok = state_read(file, &self->rng, sizeof(rng_t))
+        && state_read(file, &self->peak_branches, sizeof(size_t))
+        && state_read(file, self->map.bits, self->map.size)
+        && state_read(file, self->masks, self->masks_size)
+        && state_read(file, &owned, 1);
+
+    // Saved after the trees were joined.
+    if(ok && !owned)
+    {
+        free(self->owners);
+        self->owners = NULL;
+    }
+
+    ok = ok && (!owned || (self->owners != NULL && state_read(file, self->owners, self->nodes * sizeof(unsigned short))))
+        && state_read(file, &count, sizeof(size_t))
+        && count <= (size_t)self->params.heads;
+
+    for(size_t i = 0; ok && i < count; i++)
+    {
+        head_t head;
+        memset(&head, 0, sizeof(head_t));
+
+        int index;
+        size_t length, limit;
+
+        ok = state_read(file, &head.point, sizeof(point_t))
+            && state_read(file, &head.direction, sizeof(int))
+            && state_read(file, &head.first, sizeof(size_t))
+            && state_read(file, &head.peak, sizeof(size_t))
+            && state_read(file, &head.rng, sizeof(rng_t))
+            && state_read(file, &index, sizeof(int))
+            && state_read(file, &length, sizeof(size_t))
+            && state_read(file, &limit, sizeof(size_t))
+            && length <= limit && limit <= 2 * nodes + BRANCHES_INITIAL && head.first <= length
+            && index >= 0 && index < self->params.heads;
+
+        if(!ok) break;
+
+        MAZE_STAT(head.index = index);
+
+        if(!blist_init_with(&head.branches, limit, sizeof(point_t), arena_allocator(self->arena)))
+            return false;
+
+        head.limit = limit;
+        head.branches.length = length;
+        ok = state_read(file, head.branches.array, length * sizeof(point_t));
+
+        if(!ok || !blist_push(self->heads, &head))
+        {
+            blist_release(&head.branches);
+            ok = false;
+        }
+    }
+
+    if(!ok) fprintf(stderr, "maze_load_state() The state is cut short or doesn't match the maze!\n");
+
+    return ok;
+}
+
+// V A L I D A T I O N //
+// =================== //
+
+bool maze_validate(const maze_t* self)
+{
+    const map_t* map = &self->map;
+    int step = self->params.step;
+    int columns = self->params.width, rows = self->params.height;
+
+    // With a step of 1 every cell is a step and the steps touch, so there
+    // are no walls to keep, and the maze is whole once each one is floor.
+    if(step < 2)
+    {
+        for(int y = 0; y < self->height; y++)
+        {
+            for(int x = 0; x < self->width; x++)
+            {
+                if(map_get(map, x, y)) continue;
+
+                fprintf(stderr, "maze_validate() The step at %d, %d is a wall!\n", x, y);
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Check each cell, and count the passages. //
+    size_t passages = 0;
+    for(int y = 0; y < self->height; y++)
+    {
+        for(int x = 0; x < self->width; x++)
+        {
+            bool floor = map_get(map, x, y);
+            bool on_column = x % step == 0, on_row = y % step == 0;
+
+            if(on_column && on_row)
+            {
+                if(floor) continue;
+
+                fprintf(stderr, "maze_validate() The step at %d, %d is a wall!\n", x, y);
+                return false;
+            }
+
+            // Cells between two steps must match the rest of their passage.
+            bool in_passage = (on_row && x / step + 1 < columns) || (on_column && y / step + 1 < rows);
+            if(!in_passage)
+            {
+                if(!floor) continue;
+
+                fprintf(stderr, "maze_validate() The cell at %d, %d should be a wall!\n", x, y);
+                return false;
+            }
+
+            int first = on_row ? x % step : y % step;
+            if(first == 1)
+            {
+                passages += floor;
+            }
+            else if(floor != (on_row ? map_get(map, x - 1, y) : map_get(map, x, y - 1)))
+            {
+                fprintf(stderr, "maze_validate() The passage through %d, %d is half open!\n", x, y);
+                return false;
+            }
+        }
+    }
+
+    size_t nodes = (size_t)columns * rows;
+    if(passages != nodes - 1)
+    {
+        fprintf(stderr, "maze_validate() The maze has %zu passages, but a tree of %zu steps has %zu!\n", passages, nodes, nodes - 1);
+        return false;
+    }
+
+    // With one passage less than steps, the maze is a tree if every
+    // step can be reached from the first.
+    unsigned char* seen = calloc((nodes + 7) / 8, 1);
+    blist_t* stack = blist_create(64, sizeof(size_t));
+    if(seen == NULL || stack == NULL)
+    {
+        fprintf(stderr, "maze_validate() Failed to allocate search!\n");
+        free(seen);
+        if(stack != NULL) blist_destroy(stack);
+        return false;
+    }
+
+    size_t reached = 1, node = 0;
+    seen[0] = 1;
+    blist_push(stack, &node);
+
+    while(stack->length)
+    {
+        blist_copyget(stack, stack->length - 1, &node);
+        blist_pop(stack);
+
+        int x = node % columns * step, y = node / columns * step;
+        size_t next[4];
+        int count = 0;
+
+        if(x > 0 && map_get(map, x - 1, y)) next[count++] = node - 1;
+        if(x + step < self->width && map_get(map, x + 1, y)) next[count++] = node + 1;
+        if(y > 0 && map_get(map, x, y - 1)) next[count++] = node - columns;
+        if(y + step < self->height && map_get(map, x, y + 1)) next[count++] = node + columns;
+
+        for(int i = 0; i < count; i++)
+        {
+            if(seen[next[i] >> 3] & (1 << (next[i] & 7))) continue;
+
+            seen[next[i] >> 3] |= 1 << (next[i] & 7);
+            reached++;
+
+            if(!blist_push(stack, &next[i]))
+            {
+                fprintf(stderr, "maze_validate() Failed to grow search stack!\n");
+                free(seen);
+                blist_destroy(stack);
+                return false;
+            }
+        }
+    }
+
+    free(seen);
+    blist_destroy(stack);
+
+    if(reached != nodes)
+    {
+        fprintf(stderr, "maze_validate() Only %zu of %zu steps can be reached!\n", reached, nodes);
+        return false;
+    }
+
+    return true;
+}
+
+// S T A T S //
+// ========= //
+
+#ifdef MAZE_STATS
+void maze_get_stats(const maze_t* self, maze_stats_t* stats)
+{
+    *stats = self->stats;
+
+    for(size_t i = 0; self->heads != NULL && i < self->heads->length; i++)
+    {
+        const head_t* head = blist_get(self->heads, i);
+        maze_add_stats(stats, &head->stats);
+    }
+
+    // Every step is floor from the start, and each join carves a passage.
+    if(self->kruskal != NULL)
+    {
+        stats->steps += self->kruskal->joins;
+        stats->cells += self->kruskal->steps + (uint64_t)self->kruskal->joins * (self->params.step - 1);
+    }
+}
+
+void maze_print_stats(const maze_t* self, FILE* file)
+{
+    static const char* const mode_names[] = {NULL, "random", "depth", "breadth", "eller", "kruskal"};
+
+    maze_stats_t stats;
+    maze_get_stats(self, &stats);
+
+    const maze_params_t* params = &self->params;
+    fprintf(file, "{\"mode\": \"%s\", \"width\": %d, \"height\": %d, \"step\": %d, \"heads\": %d, \"switch_chance\": %d, \"seed\": %ld,\n",
+        mode_names[params->mode], params->width, params->height, params->step, params->heads, params->switch_chance, params->seed);
+
+    fprintf(file, " \"steps\": %llu, \"cells\": %llu, \"switches\": {\"chance\": %llu, \"dead_end\": %llu}, \"dead_branches\": %llu,\n",
+        (unsigned long long)stats.steps, (unsigned long long)stats.cells, (unsigned long long)stats.switches_chance,
+        (unsigned long long)stats.switches_dead_end, (unsigned long long)stats.dead_branches);
+
+    // Heads still running have not left their peak yet.
+    size_t peak = self->peak_branches;
+    fprintf(file, " \"head_peak_branches\": [");
+    for(int i = 0; self->kruskal == NULL && i < params->heads; i++)
+    {
+        size_t head_peak = self->head_peaks[i];
+        for(size_t j = 0; j < self->heads->length; j++)
+        {
+            const head_t* head = blist_get(self->heads, j);
+            if(head->index == i)
+            {
+                head_peak = head->peak;
+                peak += head_peak;
+            }
+        }
+
+        fprintf(file, i ? ", %zu" : "%zu", head_peak);
+    }
+
+    fprintf(file, "], \"peak_branches\": %zu,\n", peak);
+
+    if(self->arena != NULL)
+    {
+        fprintf(file, " \"arena\": {\"allocations\": %zu, \"moves\": %zu, \"frees\": %zu, \"peak_bytes\": %zu},\n",
+            self->arena->allocations, self->arena->moves, self->arena->frees, self->arena->peak);
+    }
+
+    fprintf(file, " \"seconds\": {\"reset\": %.6f, \"run\": %.6f, \"branch\": %.6f, \"join\": %.6f, \"validate\": %.6f, \"save\": %.6f}}\n",
+        stats.reset_ns * 1e-9, stats.run_ns * 1e-9, stats.branch_ns * 1e-9, stats.join_ns * 1e-9, stats.validate_ns * 1e-9, stats.save_ns * 1e-9);
+}
+#endif
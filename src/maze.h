@@ -0,0 +1,401 @@
+
+/** maze.h, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * The maze generator. It has no dependency on SDL, so it can be used
+ * by the command line tool, the viewer, or any other program.
+ *
+ * A maze keeps all of its state in its maze_t, so several mazes can be
+ * generated at once, each on its own thread. A program which makes many
+ * mazes can keep one maze_t and start each maze with `maze_reset()`, and
+ * can have the map written straight into its own memory with
+ * `maze_init_buffer()`.
+ */
+
+#ifndef MAZEGEN_MAZE_H
+#define MAZEGEN_MAZE_H
+
+#include "arena.h"
+#include "blist.h"
+#include "map.h"
+#include "rng.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+enum {
+    MODE_RANDOM_SWITCHING = 1,
+    MODE_DEPTH_FIRST = 2,
+    MODE_BREADTH_FIRST = 3,
+
+    /// Eller's algorithm. It streams the maze row by row, so it is run
+    /// by `eller_generate()` rather than by a maze_t.
+    MODE_ELLER = 4,
+
+    /// Kruskal's algorithm, which knocks down walls in a random order.
+    /// See kruskal.h.
+    MODE_KRUSKAL = 5,
+
+    /// Steps are kept row by row.
+    MAZE_LAYOUT_ROWS = 0,
+
+    /// Steps are kept in blocks of 16x16 steps, row by row within each
+    /// block, so the steps above and below a step are usually in the
+    /// same few cache lines and the same page. Experimental: finding a
+    /// step in its block costs more than the misses saved so far.
+    MAZE_LAYOUT_BLOCKS = 1,
+
+    MOVE_UP = 1,
+    MOVE_RIGHT = 2,
+    MOVE_DOWN = 3,
+    MOVE_LEFT = 4,
+};
+
+// S T A T S //
+// ========= //
+
+#ifdef MAZE_STATS
+/// Runs `statement` only in builds with MAZE_STATS, so that without it
+/// the counters and their updates are not compiled at all.
+#define MAZE_STAT(...) __VA_ARGS__
+
+/// What a maze has done so far. Each head counts into its own, which is
+/// added to the maze's once the head is done, so counting takes no atomic
+/// operations even with a thread for each head.
+typedef struct maze_stats_s {
+    /// Steps moved to, and cells carved on the way, joins included.
+    uint64_t steps, cells;
+
+    /// Branch switches made by the switch chance of MODE_RANDOM_SWITCHING,
+    /// and because the head had no paths left.
+    uint64_t switches_chance, switches_dead_end;
+
+    /// Branches with no paths left, which a head switched to and left at
+    /// once, or which were dropped before its list grew.
+    uint64_t dead_branches;
+
+    /// Nanoseconds spent in `maze_reset()`, updating or running the maze,
+    /// in `head_switch_branch()`, and joining the trees of the heads.
+    /// `validate_ns` and `save_ns` are left for the program to fill in.
+    uint64_t reset_ns, run_ns, branch_ns, join_ns, validate_ns, save_ns;
+} maze_stats_t;
+#else
+#define MAZE_STAT(...)
+#endif
+
+// P O I N T //
+// ========= //
+
+typedef struct point_s {
+    int x, y;
+} point_t;
+
+// H E A D //
+// ======= //
+
+typedef struct head_s {
+    point_t point;
+    int direction;
+
+    blist_t branches;
+    size_t first; // Index of the oldest branch, only used in MODE_BREADTH_FIRST.
+
+    /// Most branches the list has held at once.
+    size_t peak;
+
+    /// Length at which the list is next compacted. It grows as a new
+    /// list's capacity would, so a list reused from an earlier maze, which
+    /// may be bigger, compacts at the same points as a new one.
+    size_t limit;
+
+    rng_t rng;
+
+#ifdef MAZE_STATS
+    /// Number of the head, from 0, and its counters so far.
+    int index;
+    maze_stats_t stats;
+#endif
+} head_t;
+
+// M A Z E //
+// ======= //
+
+typedef struct maze_params_s {
+    /// Size of the maze in steps, not cells.
+    int width, height;
+
+    int step;
+    int heads;
+    int mode;
+    int switch_chance;
+
+    /// Keep branch order when switching in MODE_RANDOM_SWITCHING.
+    bool ordered;
+
+    /// How the masks and trees of the steps are laid out in memory, one
+    /// of the MAZE_LAYOUT values. Mazes are the same in every layout, and
+    /// the map is always laid out as described in map.h. MODE_KRUSKAL
+    /// keeps its own trees, and ignores it.
+    int layout;
+
+    long seed;
+} maze_params_t;
+
+typedef struct maze_s {
+    maze_params_t params;
+
+    /// Moves every head one step. `maze_update()` calls this kernel,
+    /// which is picked for the mode and step of the maze.
+    void (*kernel)(struct maze_s* self);
+
+    /// Size of the maze in cells.
+    int width, height;
+
+    map_t map;
+    blist_t* heads;
+
+    /// Branches lists of finished heads, kept for `maze_reset()`.
+    blist_t* spares;
+
+    /// Keeps the arrays of `heads`, `spares` and every branches list, so
+    /// they grow in place instead of being copied by `realloc()`.
+    arena_t* arena;
+
+    /// Number of places for steps in `masks` and `owners`, which in
+    /// MAZE_LAYOUT_BLOCKS includes the unused ends of the last blocks,
+    /// and the number of blocks across the maze.
+    size_t nodes, block_columns;
+
+    /// With several heads, the tree (numbered after the head which
+    /// started it) that each step belongs to. The trees are joined into
+    /// one once every head is done.
+    unsigned short* owners;
+
+    /// Unvisited neighbours of each step, as a 4-bit mask with bit
+    /// `direction - 1` for each direction, two steps to a byte. Kept up to
+    /// date as steps are visited, so heads never read the map to find a
+    /// way to go.
+    unsigned char* masks;
+    size_t masks_size;
+
+    /// Sum of the `peak` of every head which has finished, so the most
+    /// memory the branch lists have taken, in branches.
+    size_t peak_branches;
+
+    /// Only used to place the heads, which each have their own stream.
+    rng_t rng;
+
+    /// State of a maze in MODE_KRUSKAL, which has no heads, or NULL.
+    struct kruskal_s* kruskal;
+
+    /// If not NULL, every cell carved by `maze_update()` is pushed onto
+    /// this list of point_t, so a viewer can draw only what changed. The
+    /// list belongs to the maze once set, and is freed by `maze_free()`.
+    blist_t* dirty;
+
+    /// Set once a list couldn't grow, losing branches or doors, so the
+    /// maze can't be finished. `maze_done()` is then true.
+    bool failed;
+
+#ifdef MAZE_STATS
+    /// Counters of the heads which have finished, and of joining. Use
+    /// `maze_get_stats()` to include the heads still running.
+    maze_stats_t stats;
+
+    /// The `peak` of each head once it has finished, `params.heads` long.
+    size_t* head_peaks;
+#endif
+} maze_t;
+
+/** \brief Fills `params` with the default options.
+ *
+ * \param params maze_params_t*
+ * \return void
+ */
+void maze_default_params(maze_params_t* params);
+
+/** \brief Allocates the map and heads of a maze and places the heads.
+ *  Call `maze_free()` afterwards, even if this fails.
+ *
+ * \param self maze_t*
+ * \param params const maze_params_t*
+ * \return bool
+ */
+bool maze_init(maze_t* self, const maze_params_t* params);
+
+/** \brief Like `maze_init()`, but the map is kept in the `size` bytes at
+ *  `buffer`, which must be at least `maze_buffer_size()` bytes. The map
+ *  has the layout described in map.h. The buffer still belongs to the
+ *  caller, and is not freed by `maze_free()`. `maze_reset()` keeps using
+ *  it, so later mazes must fit in it too.
+ *
+ * \param self maze_t*
+ * \param params const maze_params_t*
+ * \param buffer void*
+ * \param size size_t
+ * \return bool
+ */
+bool maze_init_buffer(maze_t* self, const maze_params_t* params, void* buffer, size_t size);
+
+/** \brief Returns the number of bytes the map of a maze with `params`
+ *  takes, or 0 if `params` are ones `maze_reset()` would refuse, such as
+ *  a maze too big to address.
+ *
+ * \param params const maze_params_t*
+ * \return size_t
+ */
+size_t maze_buffer_size(const maze_params_t* params);
+
+/** \brief Starts a new maze in a maze which has already been through
+ *  `maze_init()`, reusing its map and branches lists when they fit. The
+ *  maze is the same as one made by `maze_init()` with the same `params`.
+ *
+ * \param self maze_t*
+ * \param params const maze_params_t*
+ * \return bool
+ */
+bool maze_reset(maze_t* self, const maze_params_t* params);
+void maze_free(maze_t* self);
+
+/** \brief Allocates and initialises a maze, or returns NULL if that
+ *  fails. Free it with `maze_destroy()`.
+ *
+ * \param params const maze_params_t*
+ * \return maze_t*
+ */
+maze_t* maze_create(const maze_params_t* params);
+void maze_destroy(maze_t* self);
+
+/** \brief Moves every head one step.
+ *
+ * \param self maze_t*
+ * \return void
+ */
+void maze_update(maze_t* self);
+
+/** \brief Calls `maze_update()` up to `count` times, stopping early once
+ *  the maze is done. Returns the number of updates made.
+ *
+ * \param self maze_t*
+ * \param count size_t
+ * \return size_t
+ */
+size_t maze_step(maze_t* self, size_t count);
+
+/** \brief Updates the maze until it is done. Returns false if it
+ *  failed, and so isn't finished.
+ *
+ * \param self maze_t*
+ * \return bool
+ */
+bool maze_run(maze_t* self);
+
+/** \brief Turns cell `x`, `y` into floor, and records it if the maze
+ *  keeps a list of dirty cells.
+ *
+ * \param self maze_t*
+ * \param x int
+ * \param y int
+ * \return void
+ */
+void maze_carve(maze_t* self, int x, int y);
+
+/** \brief Returns true once every head has run out of paths and branches,
+ *  or in MODE_KRUSKAL, once every step is joined, or once the maze has
+ *  `failed`.
+ *
+ * \param self maze_t*
+ * \return bool
+ */
+bool maze_done(maze_t* self);
+
+/** \brief Generates the whole maze, running each head on its own thread.
+ *  Heads claim cells atomically, and a head which runs out of branches
+ *  takes half of the branches of another head. The result depends on
+ *  thread timing, so unlike `maze_update()` it can differ between runs
+ *  with the same seed. A maze in MODE_KRUSKAL is run by `kruskal_run()`
+ *  with a thread for each head, and is the same as ever. Returns false
+ *  if the maze couldn't be finished.
+ *
+ * \param self maze_t*
+ * \return bool
+ */
+bool maze_run_parallel(maze_t* self);
+
+/** \brief Checks that the map is a perfect maze: the steps and the
+ *  passages between them form a spanning tree, and every other cell is a
+ *  wall. With a step of 1 there are no walls, so it only checks that
+ *  every cell is floor. Prints the first problem found to stderr.
+ *
+ * \param self const maze_t*
+ * \return bool
+ */
+bool maze_validate(const maze_t* self);
+
+/** \brief Writes everything the maze will be generated from to `file`:
+ *  the map, the unvisited neighbours, the trees, and the heads with their
+ *  branches and random streams. Numbers are written as this machine holds
+ *  them. Mazes in MODE_KRUSKAL can't be saved.
+ *
+ * \param self const maze_t*
+ * \param file FILE*
+ * \return bool
+ */
+bool maze_save_state(const maze_t* self, FILE* file);
+
+/** \brief Reads a state written by `maze_save_state()` into a maze set
+ *  up by `maze_init()` with the same params. Updating it from there makes
+ *  the same maze as updating the saved maze would have. Counters of
+ *  MAZE_STATS start again from 0.
+ *
+ * \param self maze_t*
+ * \param file FILE*
+ * \return bool
+ */
+bool maze_load_state(maze_t* self, FILE* file);
+
+#ifdef MAZE_STATS
+/** \brief Returns a monotonic clock in nanoseconds, for timing phases.
+ *
+ * \return uint64_t
+ */
+uint64_t maze_clock_ns(void);
+
+/** \brief Fills `stats` with the counters of the maze so far, including
+ *  the heads which are still running. Not safe to call while
+ *  `maze_run_parallel()` runs.
+ *
+ * \param self const maze_t*
+ * \param stats maze_stats_t*
+ * \return void
+ */
+void maze_get_stats(const maze_t* self, maze_stats_t* stats);
+
+/** \brief Writes the parameters and counters of the maze to `file` as a
+ *  JSON object.
+ *
+ * \param self const maze_t*
+ * \param file FILE*
+ * \return void
+ */
+void maze_print_stats(const maze_t* self, FILE* file);
+#endif
+
+#endif // MAZEGEN_MAZE_H
@@ -0,0 +1,46 @@
+
+/** rng.c, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "rng.h"
+
+static uint64_t splitmix64(uint64_t* x)
+{
+    uint64_t z = (*x += 0x9E3779B97F4A7C15);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+    return z ^ (z >> 31);
+}
+
+void rng_seed(rng_t* self, uint64_t seed, uint64_t stream)
+{
+    // Mix the stream into the seed, then expand it into the state.
+    uint64_t x = seed;
+    x = splitmix64(&x) ^ stream;
+
+    for(int i = 0; i < 4; i++)
+        self->s[i] = splitmix64(&x);
+}
+
+uint64_t rng_hash(uint64_t seed, uint64_t a, uint64_t b)
+{
+    uint64_t x = seed;
+    x = splitmix64(&x) ^ a;
+    x = splitmix64(&x) ^ b;
+    return splitmix64(&x);
+}
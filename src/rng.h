@@ -0,0 +1,108 @@
+
+/** rng.h, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * A small, fast pseudo-random number generator (xoshiro256**).
+ *
+ * Unlike rand(), it gives the same numbers on every platform and C
+ * library, and each generator has its own state, so several streams can
+ * be used at once, e.g. one per head.
+ */
+
+#ifndef MAZEGEN_RNG_H
+#define MAZEGEN_RNG_H
+
+#include <stdint.h>
+
+typedef struct rng_s {
+    uint64_t s[4];
+} rng_t;
+
+/** \brief Seeds the generator. Generators with the same `seed` but a
+ *  different `stream` produce unrelated sequences.
+ *
+ * \param self rng_t*
+ * \param seed uint64_t
+ * \param stream uint64_t
+ * \return void
+ */
+void rng_seed(rng_t* self, uint64_t seed, uint64_t stream);
+
+/** \brief Mixes `a` and `b` into `seed`, giving a new, well scrambled
+ *  seed. Used to give each part of a maze its own seed.
+ *
+ * \param seed uint64_t
+ * \param a uint64_t
+ * \param b uint64_t
+ * \return uint64_t
+ */
+uint64_t rng_hash(uint64_t seed, uint64_t a, uint64_t b);
+
+/** \brief Returns the next 64 random bits.
+ *
+ * \param self rng_t*
+ * \return uint64_t
+ */
+static inline uint64_t rng_next(rng_t* self)
+{
+    uint64_t* s = self->s;
+    uint64_t x = s[1] * 5;
+    uint64_t result = ((x << 7) | (x >> 57)) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+
+    return result;
+}
+
+/** \brief Returns a uniformly distributed number in [0, n), without the
+ *  bias of `rand() % n`. `n` must not be 0.
+ *
+ * \param self rng_t*
+ * \param n uint64_t
+ * \return uint64_t
+ */
+static inline uint64_t rng_below(rng_t* self, uint64_t n)
+{
+    if(n <= UINT32_MAX)
+    {
+        // Lemire's multiply and shift, rejecting the few values that
+        // would make some results more likely than others.
+        uint64_t m = (rng_next(self) >> 32) * n;
+        if((uint32_t)m < n)
+        {
+            uint32_t threshold = (uint32_t)-n % n;
+            while((uint32_t)m < threshold)
+                m = (rng_next(self) >> 32) * n;
+        }
+
+        return m >> 32;
+    }
+
+    uint64_t threshold = -n % n, r;
+    do r = rng_next(self); while(r < threshold);
+    return r % n;
+}
+
+#endif // MAZEGEN_RNG_H
@@ -0,0 +1,397 @@
+
+/** tiled.c, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "tiled.h"
+#include "image.h"
+
+#include <pthread.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+typedef struct tiled_s {
+    const maze_params_t* params;
+
+    /// Tile size, and number of tiles across and down.
+    int tile, columns, rows;
+
+    /// The row of tiles being generated, of which only the columns from
+    /// `first` up to `last` are kept in the band.
+    map_t band;
+    int row, first, last;
+
+    /// Next tile of the row to be generated.
+    int next;
+
+    bool failed;
+    pthread_mutex_t lock;
+} tiled_t;
+
+// T I L E S //
+// ========= //
+
+/** \brief Returns the size in steps of tile `i` of `count` tiles across
+ *  `total` steps. The last tile takes whatever is left over, so no tile
+ *  is ever a single step wide.
+ */
+static int tile_size(int tile, int count, int total, int i)
+{
+    return (i == count - 1) ? total - i * tile : tile;
+}
+
+static uint64_t tile_seed(const tiled_t* self, int x, int y)
+{
+    return rng_hash(self->params->seed, x, y);
+}
+
+/** \brief Returns which neighbour tile `x`, `y` opens a door to, MOVE_LEFT
+ *  or MOVE_UP, and sets `door` to the row or column of the door within
+ *  the tile. The first tile has no door and returns 0.
+ */
+static int tile_door(const tiled_t* self, int x, int y, int* door)
+{
+    if(x == 0 && y == 0) return 0;
+
+    rng_t rng;
+    rng_seed(&rng, tile_seed(self, x, y), UINT64_MAX);
+
+    int direction = MOVE_UP;
+    if(y == 0 || (x > 0 && (rng_next(&rng) >> 63)))
+        direction = MOVE_LEFT;
+
+    if(direction == MOVE_LEFT)
+        *door = rng_below(&rng, tile_size(self->tile, self->rows, self->params->height, y));
+    else
+        *door = rng_below(&rng, tile_size(self->tile, self->columns, self->params->width, x));
+
+    return direction;
+}
+
+static void* tiled_work(void* data)
+{
+    tiled_t* self = data;
+    int step = self->params->step;
+
+    maze_params_t params = *self->params;
+    params.height = tile_size(self->tile, self->rows, self->params->height, self->row);
+
+    // One maze for every tile this thread makes, so its memory is reused.
+    maze_t maze;
+    bool ready = false;
+
+    for(;;)
+    {
+        int x = __atomic_fetch_add(&self->next, 1, __ATOMIC_RELAXED);
+        if(x >= self->last) break;
+
+        params.width = tile_size(self->tile, self->columns, self->params->width, x);
+        params.seed = tile_seed(self, x, self->row);
+
+        bool ok = ready ? maze_reset(&maze, &params) : maze_init(&maze, &params);
+        ready = true;
+
+        if(!ok)
+        {
+            self->failed = true;
+            break;
+        }
+
+        if(!maze_run(&maze))
+        {
+            self->failed = true;
+            break;
+        }
+
+        int left = (x - self->first) * self->tile * step;
+        int door;
+
+        // Neighbouring tiles share bytes of the row, so copy one at a time.
+        pthread_mutex_lock(&self->lock);
+
+        map_blit(&self->band, left, 0, &maze.map);
+
+        // The door of the first tile kept is left of the band.
+        if(x > self->first && tile_door(self, x, self->row, &door) == MOVE_LEFT)
+        {
+            for(int k = 1; k < step; k++)
+                map_set(&self->band, left - k, door * step);
+        }
+
+        pthread_mutex_unlock(&self->lock);
+    }
+
+    if(ready) maze_free(&maze);
+    return NULL;
+}
+
+// G E N E R A T I O N //
+// =================== //
+
+static bool tiled_generate_row(tiled_t* self, int threads)
+{
+    self->next = self->first;
+
+    pthread_t* workers = malloc(threads * sizeof(pthread_t));
+    int started = 0;
+
+    if(workers != NULL)
+    {
+        for(; started < threads - 1; started++)
+        {
+            if(pthread_create(&workers[started], NULL, tiled_work, self) != 0)
+                break;
+        }
+    }
+
+    tiled_work(self);
+
+    for(int i = 0; i < started; i++)
+        pthread_join(workers[i], NULL);
+
+    free(workers);
+    return !self->failed;
+}
+
+/** \brief Opens the doors that tiles of the next row have up into the
+ *  band, and the door that the tile after the band has left into it.
+ *  `rows` is the height of the band's row of tiles, in cells.
+ */
+static void tiled_open_doors(tiled_t* self, int rows)
+{
+    int step = self->params->step;
+    int left = self->first * self->tile;
+    int door;
+
+    for(int x = self->first; self->row + 1 < self->rows && x < self->last; x++)
+    {
+        if(tile_door(self, x, self->row + 1, &door) != MOVE_UP)
+            continue;
+
+        for(int k = 1; k < step; k++)
+            map_set(&self->band, (x * self->tile + door - left) * step, rows - k);
+    }
+
+    if(self->last < self->columns && tile_door(self, self->last, self->row, &door) == MOVE_LEFT)
+    {
+        for(int k = 1; k < step; k++)
+            map_set(&self->band, (self->last * self->tile - left) * step - k, door * step);
+    }
+}
+
+bool tiled_generate(const maze_params_t* params, int tile, int threads, const char* path, int format, int depth, const image_scale_t* scale)
+{
+    int step = params->step;
+    int width = params->width * step - 1;
+
+    tiled_t self;
+    self.params = params;
+    self.tile = tile;
+    self.columns = (params->width / tile) ? params->width / tile : 1;
+    self.rows = (params->height / tile) ? params->height / tile : 1;
+    self.first = 0;
+    self.last = self.columns;
+    self.failed = false;
+
+    // The last row of tiles is the tallest.
+    int band_height = tile_size(tile, self.rows, params->height, self.rows - 1) * step;
+    if(!map_init(&self.band, width, band_height))
+        return false;
+
+    pthread_mutex_init(&self.lock, NULL);
+
+    image_t image;
+    bool ok = image_open_maze(&image, path, format, depth, params, scale);
+
+    // Top of the frame, which is all wall like the band's own frame rows.
+    if(ok) ok = image_write_row(&image, map_row(&self.band, -1));
+
+    for(self.row = 0; ok && self.row < self.rows; self.row++)
+    {
+        memset(self.band.bits, 0, self.band.size);
+
+        if(!tiled_generate_row(&self, threads))
+        {
+            fprintf(stderr, "tiled_generate() Failed to generate row %d of tiles!\n", self.row);
+            ok = false;
+            break;
+        }
+
+        int rows = tile_size(tile, self.rows, params->height, self.row) * step;
+        tiled_open_doors(&self, rows);
+
+        // The maze ends one cell after its last steps.
+        if(self.row == self.rows - 1) rows--;
+
+        for(int y = 0; ok && y < rows; y++)
+            ok = image_write_row(&image, map_row(&self.band, y));
+    }
+
+    if(ok) ok = image_write_row(&image, map_row(&self.band, -1));
+
+    if(!image_close(&image))
+    {
+        if(ok) fprintf(stderr, "tiled_generate() Failed to write '%s'!\n", path);
+        ok = false;
+    }
+
+    pthread_mutex_destroy(&self.lock);
+    map_free(&self.band);
+    return ok;
+}
+
+// R E G I O N S //
+// ============= //
+
+/** \brief Returns the tile of `count` tiles, `span` cells apart, which
+ *  cell `cell` of the map belongs to, counting the walls right of and
+ *  below each tile as its own, and the frame as the first or last tile's.
+ */
+static int tile_at(int cell, int span, int count)
+{
+    if(cell < 0) return 0;
+    return (cell / span < count) ? cell / span : count - 1;
+}
+
+/** \brief Copies `width` bits of `src`, from bit `offset`, to the start
+ *  of `dst`, clearing the bits left over in its last byte.
+ */
+static void tiled_crop(unsigned char* dst, const unsigned char* src, size_t offset, int width)
+{
+    int shift = offset & 7;
+    size_t bytes = ((size_t)width + 7) / 8;
+    src += offset >> 3;
+
+    for(size_t i = 0; i < bytes; i++)
+    {
+        unsigned int byte = src[i] << shift;
+
+        // The next byte of the row may be past its end, and is only read
+        // if some of it is wanted.
+        if(shift && (i + 1) * 8 - shift < (size_t)width)
+            byte |= src[i + 1] >> (8 - shift);
+
+        dst[i] = byte;
+    }
+
+    dst[bytes - 1] &= 0xFF << (bytes * 8 - width);
+}
+
+bool tiled_generate_region(const maze_params_t* params, int tile, int threads, const tiled_region_t* region, const char* path, int format, int depth)
+{
+    int step = params->step;
+    int width = params->width * step - 1, height = params->height * step - 1;
+    int span = tile * step;
+
+    if(region->x0 < 0 || region->y0 < 0 || region->x1 <= region->x0 || region->y1 <= region->y0 || region->x1 > width + 2 || region->y1 > height + 2)
+    {
+        fprintf(stderr, "tiled_generate_region() The region %d %d %d %d isn't inside the %dx%d image of the maze!\n",
+            region->x0, region->y0, region->x1, region->y1, width + 2, height + 2);
+        return false;
+    }
+
+    tiled_t self;
+    self.params = params;
+    self.tile = tile;
+    self.columns = (params->width / tile) ? params->width / tile : 1;
+    self.rows = (params->height / tile) ? params->height / tile : 1;
+    self.failed = false;
+
+    // Image coordinates are one cell ahead of map coordinates, because of
+    // the frame.
+    self.first = tile_at(region->x0 - 1, span, self.columns);
+    self.last = tile_at(region->x1 - 2, span, self.columns) + 1;
+    int top = tile_at(region->y0 - 1, span, self.rows);
+    int bottom = tile_at(region->y1 - 2, span, self.rows);
+
+    // The band ends with the walls right of its last tile, or the frame.
+    int left = self.first * span;
+    int band_width = ((self.last == self.columns) ? width : self.last * span) - left;
+    int band_height = tile_size(tile, self.rows, params->height, self.rows - 1) * step;
+
+    int region_width = region->x1 - region->x0;
+    size_t offset = region->x0 - left;
+
+    unsigned char* line = malloc(((size_t)region_width + 7) / 8);
+    if(line == NULL || !map_init(&self.band, band_width, band_height))
+    {
+        fprintf(stderr, "tiled_generate_region() Failed to allocate a band of %dx%d cells!\n", band_width, band_height);
+        free(line);
+        return false;
+    }
+
+    pthread_mutex_init(&self.lock, NULL);
+
+    image_t image;
+    bool ok = image_open(&image, path, format, depth, region_width, region->y1 - region->y0);
+
+    // The band's own frame rows are all wall, like the frame of the maze.
+    if(ok && region->y0 == 0)
+    {
+        tiled_crop(line, map_row(&self.band, -1), offset, region_width);
+        ok = image_write_row(&image, line);
+    }
+
+    for(self.row = top; ok && self.row <= bottom; self.row++)
+    {
+        memset(self.band.bits, 0, self.band.size);
+
+        if(!tiled_generate_row(&self, threads))
+        {
+            fprintf(stderr, "tiled_generate_region() Failed to generate row %d of tiles!\n", self.row);
+            ok = false;
+            break;
+        }
+
+        int rows = tile_size(tile, self.rows, params->height, self.row) * step;
+        tiled_open_doors(&self, rows);
+
+        if(self.row == self.rows - 1) rows--;
+
+        // Only the rows of the band inside the region are written.
+        int y = 1 + self.row * span;
+        int from = (region->y0 > y) ? region->y0 - y : 0;
+        int to = (region->y1 - y < rows) ? region->y1 - y : rows;
+
+        for(int k = from; ok && k < to; k++)
+        {
+            tiled_crop(line, map_row(&self.band, k), offset, region_width);
+            ok = image_write_row(&image, line);
+        }
+    }
+
+    if(ok && region->y1 == height + 2)
+    {
+        tiled_crop(line, map_row(&self.band, -1), offset, region_width);
+        ok = image_write_row(&image, line);
+    }
+
+    if(!image_close(&image))
+    {
+        if(ok) fprintf(stderr, "tiled_generate_region() Failed to write '%s'!\n", path);
+        ok = false;
+    }
+
+    pthread_mutex_destroy(&self.lock);
+    map_free(&self.band);
+    free(line);
+    return ok;
+}
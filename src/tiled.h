@@ -0,0 +1,82 @@
+
+/** tiled.h, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * Generates mazes which are too big to keep in memory.
+ *
+ * The maze is cut into tiles of `tile` by `tile` steps. Each tile is
+ * generated on its own, as a small maze with a seed made from the maze
+ * seed and the position of the tile, and then opens one door to the tile
+ * to its left or above it, also picked from that seed. So the tiles form
+ * a tree of trees, and the whole maze is still a perfect maze.
+ *
+ * Only one row of tiles is kept in memory. Once a row is done it is
+ * streamed to the output file and its memory is reused for the next one.
+ *
+ * Since a tile and its door depend only on the seed and where the tile
+ * is, any window of the maze can be made from just the tiles it overlaps,
+ * in time and memory that grow with the window rather than the maze.
+ */
+
+#ifndef MAZEGEN_TILED_H
+#define MAZEGEN_TILED_H
+
+#include "image.h"
+#include "maze.h"
+
+#include <stdbool.h>
+
+/// A window of the image of a tiled maze, frame included: the pixels
+/// from `x0`, `y0` up to but not including `x1`, `y1`.
+typedef struct tiled_region_s {
+    int x0, y0, x1, y1;
+} tiled_region_t;
+
+/** \brief Generates a maze with the options in `params`, in tiles of
+ *  `tile` steps, using `threads` threads for the tiles of each row, and
+ *  streams it to the image at `path`, scaled by `scale` unless it is NULL.
+ *
+ * \param params const maze_params_t*
+ * \param tile int
+ * \param threads int
+ * \param path const char*
+ * \param format int
+ * \param depth int
+ * \param scale const image_scale_t*
+ * \return bool
+ */
+bool tiled_generate(const maze_params_t* params, int tile, int threads, const char* path, int format, int depth, const image_scale_t* scale);
+
+/** \brief Saves `region` of the maze `tiled_generate()` would make with
+ *  the same options to the image at `path`, pixel for pixel, generating
+ *  only the tiles the region overlaps. Nothing is shared between calls,
+ *  so several regions can be made at once on different threads.
+ *
+ * \param params const maze_params_t*
+ * \param tile int
+ * \param threads int
+ * \param region const tiled_region_t*
+ * \param path const char*
+ * \param format int
+ * \param depth int
+ * \return bool
+ */
+bool tiled_generate_region(const maze_params_t* params, int tile, int threads, const tiled_region_t* region, const char* path, int format, int depth);
+
+#endif // MAZEGEN_TILED_H
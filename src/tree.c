@@ -0,0 +1,114 @@
+
+/** tree.c, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "tree.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+
+static uint32_t get_u32(const unsigned char* p)
+{
+    return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t get_u64(const unsigned char* p)
+{
+    return get_u32(p) | (uint64_t)get_u32(p + 4) << 32;
+}
+
+bool tree_open(tree_t* self, const char* path)
+{
+    self->data = NULL;
+    self->size = 0;
+    self->bits = NULL;
+
+    int file = open(path, O_RDONLY);
+    if(file < 0)
+    {
+        fprintf(stderr, "tree_open() Failed to open '%s'!\n", path);
+        return false;
+    }
+
+    struct stat info;
+    if(fstat(file, &info) != 0 || info.st_size < TREE_HEADER_SIZE)
+    {
+        fprintf(stderr, "tree_open() '%s' is not a .mzt file!\n", path);
+        close(file);
+        return false;
+    }
+
+    void* data = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, file, 0);
+    close(file);
+
+    if(data == MAP_FAILED)
+    {
+        fprintf(stderr, "tree_open() Failed to map '%s'!\n", path);
+        return false;
+    }
+
+    self->data = data;
+    self->size = info.st_size;
+
+    const unsigned char* header = data;
+    if(memcmp(header, TREE_MAGIC, 4) != 0 || header[4] != TREE_VERSION || header[5] != 0)
+    {
+        fprintf(stderr, "tree_open() '%s' is not a version %d .mzt file!\n", path, TREE_VERSION);
+        return false;
+    }
+
+    uint32_t header_size = header[6] | header[7] << 8;
+    uint32_t columns = get_u32(header + 8), rows = get_u32(header + 12);
+
+    self->columns = columns;
+    self->rows = rows;
+    self->stride = get_u32(header + 16);
+    self->step = get_u32(header + 20);
+    self->mode = get_u32(header + 24);
+    self->seed = (int64_t)get_u64(header + 32);
+    self->bits = header + header_size;
+
+    // Every row must be in the file, so no question can read past it.
+    if(header_size < TREE_HEADER_SIZE || header_size > self->size || columns > INT32_MAX || rows > INT32_MAX
+       || self->stride < ((size_t)columns * 2 + 7) / 8
+       || (self->size - header_size) / (self->stride ? self->stride : 1) < rows)
+    {
+        fprintf(stderr, "tree_open() '%s' is cut short or has a bad header!\n", path);
+        return false;
+    }
+
+    return true;
+}
+
+void tree_close(tree_t* self)
+{
+    if(self->data != NULL)
+        munmap(self->data, self->size);
+
+    self->data = NULL;
+    self->bits = NULL;
+}
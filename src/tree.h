@@ -0,0 +1,138 @@
+
+/** tree.h, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * Reads mazes saved in the compact .mzt format, which holds the passages
+ * of a maze rather than its pixels: 2 bits per step, one set if the step
+ * opens to the step on its right, and one if it opens to the step below.
+ * A 10000x10000 maze takes 25 MB, without a frame or any walls.
+ *
+ * The file is a 64-byte header followed by one row of bits per row of
+ * steps. All numbers are little-endian.
+ *
+ *  offset  size  field
+ *       0     4  "MAZT"
+ *       4     2  version, 1
+ *       6     2  size of the header, 64
+ *       8     4  steps across (columns)
+ *      12     4  steps down (rows)
+ *      16     4  bytes per row of steps (stride)
+ *      20     4  step, in cells
+ *      24     4  mode the maze was made with, as in maze.h
+ *      28     4  zero
+ *      32     8  seed, signed
+ *      40    24  zero
+ *
+ * Step `x` of a row is in byte `x / 4` of the row, in bits `2 * (x % 4)`
+ * (TREE_EAST) and `2 * (x % 4) + 1` (TREE_SOUTH).
+ *
+ * `tree_open()` maps the file into memory and reads nothing but the
+ * header, so opening a maze takes the same time whatever its size, and
+ * every question about a wall is answered from the mapped bytes.
+ */
+
+#ifndef MAZEGEN_TREE_H
+#define MAZEGEN_TREE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TREE_MAGIC "MAZT"
+#define TREE_VERSION 1
+#define TREE_HEADER_SIZE 64
+
+enum {
+    TREE_EAST = 1,
+    TREE_SOUTH = 2,
+};
+
+typedef struct tree_s {
+    /// Number of steps across and down, and bytes per row of steps.
+    int columns, rows;
+    size_t stride;
+
+    int step, mode;
+    int64_t seed;
+
+    /// First row of steps, just after the header.
+    const unsigned char* bits;
+
+    /// The whole mapped file.
+    void* data;
+    size_t size;
+} tree_t;
+
+/** \brief Maps the .mzt file at `path` into memory and checks its header.
+ *  Call `tree_close()` afterwards, even if this fails.
+ *
+ * \param self tree_t*
+ * \param path const char*
+ * \return bool
+ */
+bool tree_open(tree_t* self, const char* path);
+void tree_close(tree_t* self);
+
+/** \brief Returns the TREE_EAST and TREE_SOUTH bits of step `x`, `y`,
+ *  which must be inside the maze.
+ *
+ * \param self const tree_t*
+ * \param x int
+ * \param y int
+ * \return int
+ */
+static inline int tree_passages(const tree_t* self, int x, int y)
+{
+    return (self->bits[(size_t)y * self->stride + (x >> 2)] >> ((x & 3) * 2)) & 3;
+}
+
+/** \brief Returns true if there is a wall between steps `ax`, `ay` and
+ *  `bx`, `by`. Steps which aren't neighbours, or are outside the maze,
+ *  always have a wall between them.
+ *
+ * \param self const tree_t*
+ * \param ax int
+ * \param ay int
+ * \param bx int
+ * \param by int
+ * \return bool
+ */
+static inline bool tree_wall(const tree_t* self, int ax, int ay, int bx, int by)
+{
+    // Ask the step which is left of or above the other.
+    if(bx < ax || by < ay)
+    {
+        int x = ax, y = ay;
+        ax = bx, ay = by;
+        bx = x, by = y;
+    }
+
+    if(ax < 0 || ay < 0 || bx >= self->columns || by >= self->rows)
+        return true;
+
+    if(by == ay && bx == ax + 1)
+        return !(tree_passages(self, ax, ay) & TREE_EAST);
+
+    if(bx == ax && by == ay + 1)
+        return !(tree_passages(self, ax, ay) & TREE_SOUTH);
+
+    return true;
+}
+
+#endif // MAZEGEN_TREE_H
@@ -0,0 +1,365 @@
+
+/** viewer.c, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifdef MAZEGEN_VIEWER
+
+#include "viewer.h"
+
+#include <SDL.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+
+// P R O T O T Y P E S //
+// =================== //
+
+void input();
+void render(maze_t* maze);
+
+// G L O B A L S //
+// ============= //
+
+static SDL_Window* window = NULL;
+static SDL_Renderer* renderer = NULL;
+
+/// One texel per cell, kept between frames so only changed cells are sent.
+static SDL_Texture* texture = NULL;
+
+static const Uint32 WALL = 0xFF000000, FLOOR = 0xFFFFFFFF;
+
+/// Longest run of cells sent to the texture at once.
+#define RUN_MAX 64
+static Uint32 floors[RUN_MAX];
+
+/// Frames per second, or 0 to draw frames as fast as the display takes them.
+static int fps = 60;
+
+/// Budget of `maze_update()` steps per second, or 0 for as many as fit
+/// in each frame.
+static double speed = 10;
+
+/// Steps made in the last frame, and how long it took in seconds.
+static size_t frame_steps = 0;
+static double frame_seconds = 0;
+
+/// Window pixels per cell, and the part of the window the maze fills.
+static double scale;
+static SDL_Rect area;
+
+static bool running = true;
+
+// F U N C T I O N S //
+// ================= //
+
+bool viewer_init(maze_t* maze, int width, int height, int frames, int steps)
+{
+    fps = frames > 0 ? frames : 0;
+    speed = steps > 0 ? steps : 0;
+
+    // Initialise SDL. //
+    if(SDL_Init(SDL_INIT_VIDEO) < 0)
+    {
+        fprintf(stderr, "SDL could not initialise! SDL Error: %s\n", SDL_GetError());
+        return false;
+    }
+
+    // Initialise window and renderer. //
+    window = SDL_CreateWindow("mazegen", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, width, height, SDL_WINDOW_SHOWN);
+    if(window == NULL)
+    {
+        fprintf(stderr, "Window could not be created! SDL Error: %s\n", SDL_GetError());
+        return false;
+    }
+
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    if(renderer == NULL)
+    {
+        fprintf(stderr, "Renderer could not be created! SDL Error: %s\n", SDL_GetError());
+        return false;
+    }
+
+    // Mazes bigger than the window are scaled down, smaller ones are
+    // scaled up by a whole number so every cell is the same size.
+    scale = fmin((double) width / maze->width, (double) height / maze->height);
+    if(scale > 1) scale = floor(scale);
+
+    area.w = fmax(1, maze->width * scale);
+    area.h = fmax(1, maze->height * scale);
+    area.x = (width - area.w) / 2;
+    area.y = (height - area.h) / 2;
+
+    texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, maze->width, maze->height);
+    if(texture == NULL)
+    {
+        fprintf(stderr, "Texture could not be created! SDL Error: %s\n", SDL_GetError());
+        return false;
+    }
+
+    // Draw the maze as it is now, then only what `maze_update()` carves.
+    void* pixels;
+    int pitch;
+    if(SDL_LockTexture(texture, NULL, &pixels, &pitch) < 0)
+    {
+        fprintf(stderr, "Texture could not be locked! SDL Error: %s\n", SDL_GetError());
+        return false;
+    }
+
+    for(int y = 0; y < maze->height; y++)
+    {
+        Uint32* row = (Uint32*) ((unsigned char*) pixels + (size_t) y * pitch);
+        for(int x = 0; x < maze->width; x++)
+            row[x] = map_get(&maze->map, x, y) ? FLOOR : WALL;
+    }
+
+    SDL_UnlockTexture(texture);
+
+    for(int i = 0; i < RUN_MAX; i++)
+        floors[i] = FLOOR;
+
+    if(maze->dirty == NULL)
+        maze->dirty = blist_create(256, sizeof(point_t));
+
+    if(maze->dirty == NULL)
+    {
+        fprintf(stderr, "viewer_init() Failed to allocate dirty cells list!\n");
+        return false;
+    }
+
+    return true;
+}
+
+void viewer_quit()
+{
+    // Close SDL. //
+    if(SDL_WasInit(0) > 0)
+    {
+        if(texture != NULL)
+            SDL_DestroyTexture(texture);
+
+        if(renderer != NULL)
+            SDL_DestroyRenderer(renderer);
+
+        if(window != NULL)
+            SDL_DestroyWindow(window);
+
+        SDL_Quit();
+    }
+}
+
+/** \brief Sets the window title to the current speed.
+ */
+static void show_speed()
+{
+    char title[64];
+    if(speed > 0)
+        snprintf(title, sizeof(title), "mazegen - %.0f steps/s", speed);
+    else
+        snprintf(title, sizeof(title), "mazegen - unlimited steps/s");
+
+    SDL_SetWindowTitle(window, title);
+}
+
+bool viewer_run(maze_t* maze)
+{
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+
+    // Steps are made until the budget is spent or the frame is due, so a
+    // slow maze never holds up the window. Without a frame rate, frames
+    // are still due at least every 60th of a second.
+    Uint64 frame = frequency / (fps ? fps : 60);
+
+    double owed = 0;
+    Uint64 last = SDL_GetPerformanceCounter();
+
+    show_speed();
+
+    while(!maze_done(maze) && running)
+    {
+        Uint64 start = SDL_GetPerformanceCounter();
+        Uint64 due = start + frame;
+
+        input();
+
+        // Steps owed for the wall time since the last frame.
+        owed += (double) (start - last) / frequency * speed;
+        last = start;
+
+        size_t budget = (speed > 0) ? (size_t) owed : SIZE_MAX;
+        owed -= (speed > 0) ? budget : 0;
+
+        frame_steps = 0;
+        while(budget > 0 && !maze_done(maze))
+        {
+            size_t steps = maze_step(maze, budget < 256 ? budget : 256);
+            frame_steps += steps;
+            budget -= steps;
+
+            if(SDL_GetPerformanceCounter() >= due)
+            {
+                // Behind; drop what is owed rather than trying to catch up.
+                owed = 0;
+                break;
+            }
+        }
+
+        render(maze);
+
+        Uint64 now = SDL_GetPerformanceCounter();
+        if(fps && now < due)
+            SDL_Delay((due - now) * 1000 / frequency);
+
+        frame_seconds = (double) (SDL_GetPerformanceCounter() - start) / frequency;
+    }
+
+    return running;
+}
+
+void viewer_wait()
+{
+    // Loop until the user quits.
+    while(running)
+    {
+        input();
+        SDL_Delay(20);
+    }
+}
+
+void input()
+{
+    SDL_Event event;
+    while(SDL_PollEvent(&event))
+    {
+        switch(event.type)
+        {
+            case SDL_QUIT:
+                running = false;
+                break;
+
+            case SDL_KEYDOWN:
+
+                if(event.key.keysym.scancode == SDL_SCANCODE_ESCAPE)
+                    running = false;
+                break;
+
+            case SDL_KEYUP:
+
+                // Halve or double the steps per second. Slowing down from
+                // unlimited starts from the speed of the last frame.
+                if(event.key.keysym.scancode == SDL_SCANCODE_MINUS)
+                {
+                    if(speed == 0) speed = frame_seconds > 0 ? floor(frame_steps / frame_seconds) : 1;
+
+                    speed = fmax(1, floor(speed / 2));
+                    show_speed();
+                }
+                else if(event.key.keysym.scancode == SDL_SCANCODE_EQUALS)
+                {
+                    if(speed > 0) speed *= 2;
+                    show_speed();
+                }
+        }
+    }
+}
+
+/** \brief Returns true if `cell` is next to the end of `run`, which is
+ *  one row high or one column wide, and grows `run` to cover it.
+ */
+static bool extend_run(SDL_Rect* run, const point_t* cell)
+{
+    if(run->h == 1 && run->w < RUN_MAX && cell->y == run->y)
+    {
+        if(cell->x == run->x + run->w)
+        {
+            run->w++;
+            return true;
+        }
+
+        if(cell->x == run->x - 1)
+        {
+            run->x--;
+            run->w++;
+            return true;
+        }
+    }
+
+    if(run->w == 1 && run->h < RUN_MAX && cell->x == run->x)
+    {
+        if(cell->y == run->y + run->h)
+        {
+            run->h++;
+            return true;
+        }
+
+        if(cell->y == run->y - 1)
+        {
+            run->y--;
+            run->h++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void render(maze_t* maze)
+{
+    // Send the cells carved since the last frame to the texture, joining
+    // the cells of each move into one run.
+    blist_t* dirty = maze->dirty;
+    SDL_Rect run = {0, 0, 0, 0};
+
+    for(size_t i = 0; i < dirty->length; i++)
+    {
+        point_t* cell = blist_get(dirty, i);
+        if(run.w > 0 && extend_run(&run, cell)) continue;
+
+        if(run.w > 0) SDL_UpdateTexture(texture, &run, floors, run.w * sizeof(Uint32));
+
+        run.x = cell->x;
+        run.y = cell->y;
+        run.w = run.h = 1;
+    }
+
+    if(run.w > 0) SDL_UpdateTexture(texture, &run, floors, run.w * sizeof(Uint32));
+
+    blist_clear(dirty);
+
+    SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0xFF);
+    SDL_RenderClear(renderer);
+
+    // Render map. //
+    SDL_RenderCopy(renderer, texture, NULL, &area);
+
+    // Render heads. //
+    int size = fmax(1, scale);
+    SDL_SetRenderDrawColor(renderer, 0xFF, 0x40, 0x40, 0xFF);
+    for(size_t i = 0; i < maze->heads->length; i++)
+    {
+        head_t* head = blist_get(maze->heads, i);
+
+        SDL_Rect headr = {area.x + head->point.x * scale, area.y + head->point.y * scale, size, size};
+        SDL_RenderFillRect(renderer, &headr);
+    }
+
+    SDL_RenderPresent(renderer);
+}
+
+#endif // MAZEGEN_VIEWER
@@ -0,0 +1,62 @@
+
+/** viewer.h, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * An SDL2 window which shows a maze being generated. It is only
+ * compiled when MAZEGEN_VIEWER is defined, so the rest of the program
+ * can be built and run without SDL.
+ */
+
+#ifndef MAZEGEN_VIEWER_H
+#define MAZEGEN_VIEWER_H
+
+#include "maze.h"
+
+#include <stdbool.h>
+
+/** \brief Initialises SDL and opens a `width` by `height` window, which
+ *  draws `frames` frames and makes `steps` steps of the maze per second.
+ *  Either may be 0 for as many as possible. Call `viewer_quit()`
+ *  afterwards, even if this fails.
+ *
+ * \param maze maze_t*
+ * \param width int
+ * \param height int
+ * \param frames int
+ * \param steps int
+ * \return bool
+ */
+bool viewer_init(maze_t* maze, int width, int height, int frames, int steps);
+void viewer_quit();
+
+/** \brief Generates the maze, drawing what changed once per frame.
+ *  Returns false if the window was closed before the maze was done.
+ *
+ * \param maze maze_t*
+ * \return bool
+ */
+bool viewer_run(maze_t* maze);
+
+/** \brief Keeps the window open until the user closes it.
+ *
+ * \return void
+ */
+void viewer_wait();
+
+#endif // MAZEGEN_VIEWER_H
@@ -0,0 +1,138 @@
+
+/** test/alloc.c, maze-generator-c
+ *
+ *  Copyright (C) 2021 Czespo
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+/**
+ * Checks that a maze whose allocations fail is reported as failed, and
+ * never as a finished maze. Each maze is run again and again, failing
+ * its first, second, third... allocation after `maze_init()`, until a
+ * run needs no more allocations than that. A run which says it is done
+ * must then pass `maze_validate()`. Exits with 1 if any doesn't.
+ *
+ *  cc -O2 -pthread -Isrc -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc -o alloc-test test/alloc.c src/maze.c src/kruskal.c src/arena.c src/map.c src/blist.c src/rng.c
+ */
+
+#include "maze.h"
+#include "kruskal.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* data, size_t size);
+
+/// Allocations left before one fails, or -1 to never fail. Only the
+/// thread running the test allocates while it counts down.
+static long countdown = -1;
+
+static bool allocation_fails()
+{
+    if(countdown < 0) return false;
+    return countdown-- == 0;
+}
+
+void* __wrap_malloc(size_t size)
+{
+    return allocation_fails() ? NULL : __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size)
+{
+    return allocation_fails() ? NULL : __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* data, size_t size)
+{
+    return allocation_fails() ? NULL : __real_realloc(data, size);
+}
+
+/** \brief Runs the maze of `params` once for every allocation it makes,
+ *  failing that allocation. Returns the number of runs which claimed to
+ *  be done but weren't.
+ */
+static int check(const maze_params_t* params, bool parallel, const char* name)
+{
+    int wrong = 0, failed = 0;
+
+    for(long n = 0; ; n++)
+    {
+        maze_t maze = {0};
+        if(!maze_init(&maze, params))
+        {
+            fprintf(stderr, "%s: failed to initialise maze!\n", name);
+            maze_free(&maze);
+            return wrong + 1;
+        }
+
+        countdown = n;
+        bool done = parallel ? maze_run_parallel(&maze) : maze_run(&maze);
+        bool injected = countdown < 0;
+        countdown = -1;
+
+        if(done && !maze_validate(&maze))
+        {
+            fprintf(stderr, "%s: failing allocation %ld left an unfinished maze which says it is done!\n", name, n);
+            wrong++;
+        }
+        else if(!done && !injected)
+        {
+            fprintf(stderr, "%s: the maze failed without a failed allocation!\n", name);
+            wrong++;
+        }
+
+        failed += injected && !done;
+        maze_free(&maze);
+
+        // The run got through all of its allocations.
+        if(!injected)
+        {
+            printf("%s: %ld allocations, %d failures reported\n", name, n, failed);
+            return wrong;
+        }
+    }
+}
+
+int main()
+{
+    maze_params_t params;
+    maze_default_params(&params);
+    params.width = 60;
+    params.height = 40;
+    params.seed = 7;
+
+    int wrong = 0;
+
+    params.mode = MODE_DEPTH_FIRST;
+    wrong += check(&params, false, "depth");
+
+    params.mode = MODE_RANDOM_SWITCHING;
+    params.heads = 4;
+    params.step = 3;
+    wrong += check(&params, false, "random, 4 heads");
+    wrong += check(&params, true, "random, 4 heads, parallel");
+
+    params.mode = MODE_KRUSKAL;
+    params.heads = 1;
+    params.step = 2;
+    wrong += check(&params, false, "kruskal");
+    wrong += check(&params, true, "kruskal, parallel");
+
+    return wrong ? EXIT_FAILURE : EXIT_SUCCESS;
+}